@@ -66,6 +66,7 @@ class Engine {
     std::unique_ptr<AudioManager> audio_manager;
     std::unique_ptr<ResourcesManager> resources_manager;
     std::unique_ptr<UDPStatsExporter> udp_stats_exporter;
+    std::unique_ptr<WorkersPool> workers_pool;
 
     Engine(
         const glm::uvec2& virtual_resolution,
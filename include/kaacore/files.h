@@ -17,4 +17,26 @@ class File {
     File(const std::string& path) noexcept(false);
 };
 
+class MappedFile {
+    // Read-only view of file content, memory mapped on platforms
+    // that support it, otherwise read into memory like `File`.
+  public:
+    const std::string path;
+
+    MappedFile(const std::string& path) noexcept(false);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const;
+    size_t size() const;
+    bool is_mapped() const;
+
+  private:
+    const uint8_t* _data;
+    size_t _size;
+    bool _is_mapped;
+    std::vector<uint8_t> _content;
+};
+
 } // namespace kaacore
@@ -48,6 +48,114 @@ operator&(const Alignment alignment, const uint8_t mask)
     return uint8_t(alignment) & mask;
 }
 
+template<typename T>
+struct AffineTransformation {
+    // Compact 2x3 matrix of 2D affine transformation, columns
+    // are images of X and Y axes followed by translation.
+    glm::tvec2<T> x_axis;
+    glm::tvec2<T> y_axis;
+    glm::tvec2<T> translation;
+
+    AffineTransformation() : x_axis(1, 0), y_axis(0, 1), translation(0, 0) {}
+
+    AffineTransformation(
+        const glm::tvec2<T>& x_axis, const glm::tvec2<T>& y_axis,
+        const glm::tvec2<T>& translation
+    )
+        : x_axis(x_axis), y_axis(y_axis), translation(translation)
+    {}
+
+    template<typename U>
+    explicit AffineTransformation(const AffineTransformation<U>& other)
+        : x_axis(other.x_axis), y_axis(other.y_axis),
+          translation(other.translation)
+    {}
+
+    template<typename U>
+    explicit AffineTransformation(const glm::tmat4x4<U>& matrix)
+        : x_axis(matrix[0][0], matrix[0][1]),
+          y_axis(matrix[1][0], matrix[1][1]),
+          translation(matrix[3][0], matrix[3][1])
+    {}
+
+    static AffineTransformation from_components(
+        const glm::tvec2<T>& translation, const T rotation,
+        const glm::tvec2<T>& scale
+    )
+    {
+        // equivalent of translate * rotate * scale
+        const T cos_r = std::cos(rotation);
+        const T sin_r = std::sin(rotation);
+        return {
+            glm::tvec2<T>{cos_r, sin_r} * scale.x,
+            glm::tvec2<T>{-sin_r, cos_r} * scale.y, translation
+        };
+    }
+
+    bool operator==(const AffineTransformation& other) const
+    {
+        return this->x_axis == other.x_axis and
+               this->y_axis == other.y_axis and
+               this->translation == other.translation;
+    }
+
+    // composition, `other` is applied first
+    AffineTransformation operator*(const AffineTransformation& other) const
+    {
+        return {
+            this->apply_vector(other.x_axis), this->apply_vector(other.y_axis),
+            this->apply(other.translation)
+        };
+    }
+
+    glm::tvec2<T> apply(const glm::tvec2<T>& point) const
+    {
+        return this->x_axis * point.x + this->y_axis * point.y +
+               this->translation;
+    }
+
+    glm::tvec2<T> apply_vector(const glm::tvec2<T>& vector) const
+    {
+        return this->x_axis * vector.x + this->y_axis * vector.y;
+    }
+
+    T determinant() const
+    {
+        return this->x_axis.x * this->y_axis.y -
+               this->y_axis.x * this->x_axis.y;
+    }
+
+    bool is_invertible() const { return this->determinant() != T(0); }
+
+    AffineTransformation inverse() const
+    {
+        const T inverse_determinant = T(1) / this->determinant();
+        const glm::tvec2<T> inverse_x_axis =
+            glm::tvec2<T>{this->y_axis.y, -this->x_axis.y} *
+            inverse_determinant;
+        const glm::tvec2<T> inverse_y_axis =
+            glm::tvec2<T>{-this->y_axis.x, this->x_axis.x} *
+            inverse_determinant;
+        return {
+            inverse_x_axis, inverse_y_axis,
+            -(inverse_x_axis * this->translation.x +
+              inverse_y_axis * this->translation.y)
+        };
+    }
+
+    glm::tmat4x4<T> to_mat4() const
+    {
+        glm::tmat4x4<T> matrix(1);
+        matrix[0][0] = this->x_axis.x;
+        matrix[0][1] = this->x_axis.y;
+        matrix[1][0] = this->y_axis.x;
+        matrix[1][1] = this->y_axis.y;
+        matrix[3][0] = this->translation.x;
+        matrix[3][1] = this->translation.y;
+        return matrix;
+    }
+};
+
 template<typename T>
 struct DecomposedTransformation {
     glm::tvec2<T> scale;
@@ -70,12 +178,30 @@ struct DecomposedTransformation {
         this->rotation = glm::eulerAngles(_rotation_quat).z;
         this->translation = _translation;
     }
+
+    DecomposedTransformation(const AffineTransformation<T>& transformation)
+    {
+        // same conventions as glm::decompose, negative
+        // determinant is represented by negating both scales
+        this->scale = {
+            glm::length(transformation.x_axis),
+            glm::length(transformation.y_axis)
+        };
+        glm::tvec2<T> rotated_x_axis = transformation.x_axis;
+        if (transformation.determinant() < T(0)) {
+            this->scale = -this->scale;
+            rotated_x_axis = -rotated_x_axis;
+        }
+        this->rotation = std::atan2(rotated_x_axis.y, rotated_x_axis.x);
+        this->translation = transformation.translation;
+    }
 };
 
 class Transformation {
   public:
     Transformation();
     Transformation(const glm::dmat4& matrix);
+    Transformation(const AffineTransformation<double>& transformation);
     bool operator==(Transformation const& other) const;
 
     static Transformation translate(const glm::dvec2& tr);
@@ -86,9 +212,11 @@ class Transformation {
 
     double at(const size_t col, const size_t row) const;
     const DecomposedTransformation<double> decompose() const;
+    const AffineTransformation<double>& affine() const;
+    glm::dmat4 matrix() const;
 
   private:
-    glm::dmat4 _matrix;
+    AffineTransformation<double> _transformation;
 
     friend Transformation operator|(
         const Transformation& left, const Transformation& right
@@ -1,9 +1,31 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+
 namespace kaacore {
 
 class Node;
 
+struct NodeHandle {
+    // Generational reference to a node attached to the scene tree,
+    // resolved with `Scene::resolve`. Once the node is removed from
+    // the tree handle resolves to null, even if its slot is reused.
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+
+    explicit operator bool() const { return this->generation != 0; }
+    bool operator==(const NodeHandle& other) const
+    {
+        return this->slot == other.slot and
+               this->generation == other.generation;
+    }
+    bool operator!=(const NodeHandle& other) const
+    {
+        return not(*this == other);
+    }
+};
+
 class _NodePtrBase {
   public:
     operator bool() const;
@@ -45,3 +67,15 @@ class NodeOwnerPtr : public _NodePtrBase {
 };
 
 } // namespace kaacore
+
+namespace std {
+template<>
+struct hash<kaacore::NodeHandle> {
+    size_t operator()(const kaacore::NodeHandle& handle) const
+    {
+        return std::hash<uint64_t>{}(
+            (static_cast<uint64_t>(handle.generation) << 32) | handle.slot
+        );
+    }
+};
+} // namespace std
@@ -2,19 +2,24 @@
 
 #include <bitset>
 #include <deque>
+#include <limits>
 #include <memory>
 #include <optional>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include <bgfx/bgfx.h>
 #include <glm/glm.hpp>
 
+#include "kaacore/clock.h"
 #include "kaacore/draw_unit.h"
 #include "kaacore/fonts.h"
 #include "kaacore/geometry.h"
 #include "kaacore/materials.h"
 #include "kaacore/node_ptr.h"
+#include "kaacore/particles.h"
 #include "kaacore/physics.h"
 #include "kaacore/renderer.h"
 #include "kaacore/resources.h"
@@ -22,6 +27,7 @@
 #include "kaacore/spatial_index.h"
 #include "kaacore/sprites.h"
 #include "kaacore/stencil.h"
+#include "kaacore/tilemap.h"
 #include "kaacore/transitions.h"
 #include "kaacore/viewports.h"
 
@@ -33,6 +39,16 @@ enum struct NodeType {
     body = 3,
     hitbox = 4,
     text = 5,
+    particle_emitter = 6,
+    tilemap = 7,
+};
+
+enum struct OffscreenUpdatePolicy {
+    // What happens to node's subtree when none of its nodes
+    // is inside visible area of the node's viewports.
+    always = 0,
+    pause_drawing = 1,
+    pause_all = 2,
 };
 
 struct ForeignNodeWrapper {
@@ -45,6 +61,146 @@ struct ForeignNodeWrapper {
 };
 
 struct Scene;
+class Node;
+
+struct NodesPreorderIndex {
+    // Flat, pre-order list of all nodes attached to the scene tree.
+    // Every subtree occupies a contiguous range that starts with its
+    // root (see `Node::_preorder_position` and `Node::_subtree_size`),
+    // so it can be visited with a linear walk instead of a BFS.
+    // Index is kept up to date incrementally when nodes are added
+    // and removed, in cases where that would be too expensive
+    // it is invalidated and rebuilt with the next processing queue.
+    std::vector<Node*> nodes;
+    bool is_valid = false;
+    uint32_t active_walks = 0;
+
+    void rebuild(Node* const root);
+    void invalidate();
+    void insert_subtree(Node* const subtree_root);
+    void insert_children(Node* const parent, const size_t first_child_index);
+    void remove_marked(const std::vector<Node*>& marked_nodes);
+
+    struct WalkGuard {
+        NodesPreorderIndex& index;
+
+        WalkGuard(NodesPreorderIndex& index) : index(index)
+        {
+            this->index.active_walks++;
+        }
+        ~WalkGuard() { this->index.active_walks--; }
+    };
+
+    // maximum number of nodes that may need to be shifted
+    // on insertion before index falls back to invalidation
+    static constexpr size_t max_insertion_shift = 4096;
+
+  private:
+    void _append_subtree(Node* const subtree_root);
+};
+
+class NodesLifetimeQueue {
+    // Indexed min-heap of nodes with lifetime set, ordered
+    // by expiration time measured with queue's own clock,
+    // so only nodes that actually expire are touched on advance.
+  public:
+    static constexpr uint32_t unscheduled =
+        std::numeric_limits<uint32_t>::max();
+
+    void schedule(Node* const node, const HighPrecisionDuration lifetime);
+    void unschedule(Node* const node);
+    void clear();
+    HighPrecisionDuration remaining(const Node* const node) const;
+    void advance(const HighPrecisionDuration dt);
+    Node* pop_expired();
+    size_t size() const;
+
+  private:
+    HighPrecisionDuration _clock = 0us;
+    std::vector<Node*> _heap;
+
+    bool _is_before(const uint32_t lhs, const uint32_t rhs) const;
+    void _place(Node* const node, const uint32_t position);
+    void _sift_up(uint32_t position);
+    void _sift_down(uint32_t position);
+};
+
+class NodesGroupsIndex {
+    // Nodes attached to the scene tree, grouped by their tags.
+    // Every tag of a node remembers node's position in its group,
+    // so node can be removed by swapping it with the group's last node.
+  public:
+    static constexpr uint32_t unindexed = std::numeric_limits<uint32_t>::max();
+
+    void add(Node* const node);
+    void add(Node* const node, const std::string& tag);
+    void remove(Node* const node);
+    void remove(Node* const node, const std::string& tag);
+    void clear();
+    const std::vector<Node*>& group(const std::string& tag) const;
+    size_t group_size(const std::string& tag) const;
+
+  private:
+    std::unordered_map<std::string, std::vector<Node*>> _groups;
+};
+
+class NodesHandlesRegistry {
+    // Slots of nodes referenced by `NodeHandle`, assigned lazily
+    // when handle is first requested. Slot's generation is bumped
+    // when node leaves the tree, which invalidates old handles.
+  public:
+    static constexpr uint32_t unassigned =
+        std::numeric_limits<uint32_t>::max();
+
+    NodeHandle acquire(Node* const node);
+    void release(Node* const node);
+    Node* resolve(const NodeHandle& handle) const;
+    void clear();
+    size_t size() const;
+
+  private:
+    struct Slot {
+        Node* node = nullptr;
+        uint32_t generation = 1;
+    };
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _free_slots;
+};
+
+struct NodeTag {
+    std::string name;
+    uint32_t group_position = NodesGroupsIndex::unindexed;
+};
+
+struct NodeTemplate {
+    // Common properties of nodes created with `Node::spawn_children`.
+    NodeType type = NodeType::basic;
+    Shape shape;
+    Sprite sprite;
+    std::optional<int16_t> z_index = std::nullopt;
+    glm::dvec4 color = {1., 1., 1., 1.};
+    bool visible = true;
+    Alignment origin_alignment = Alignment::none;
+    Duration lifetime = 0us;
+    bool indexable = false;
+};
+
+struct NodeColdData {
+    // Rarely used node state, allocated only for nodes that need it,
+    // so it doesn't take space in nodes visited every frame.
+    NodeTransitionsManager transitions_manager;
+    ResourceReference<Material> material;
+    std::optional<RenderPassIndexSet> render_passes = std::nullopt;
+    std::optional<ViewportIndexSet> viewports = std::nullopt;
+    std::unique_ptr<ForeignNodeWrapper> node_wrapper;
+    std::vector<NodeTag> tags;
+};
+
+struct NodeSpawnTransformation {
+    glm::dvec2 position = {0., 0.};
+    double rotation = 0.;
+    glm::dvec2 scale = {1., 1.};
+};
 
 class Node {
   public:
@@ -55,12 +211,24 @@ class Node {
         BodyNode body;
         HitboxNode hitbox;
         TextNode text;
+        ParticleEmitterNode particle_emitter;
+        TilemapNode tilemap;
     };
 
     Node(NodeType type = NodeType::basic);
     ~Node();
 
     NodePtr add_child(NodeOwnerPtr& child_node);
+    std::vector<NodePtr> spawn_children(
+        const NodeTemplate& node_template,
+        const std::vector<NodeSpawnTransformation>& transformations
+    );
+    void destroy_children();
+    // Does the work which would otherwise be done when subtree enters
+    // the scene or during its first frame (tilemap chunk meshes, hitbox
+    // physics shapes). Detached subtree can be built and prepared
+    // on a worker thread, as long as no other thread accesses it.
+    void prepare_subtree();
     void recalculate_model_matrix();
     void recalculate_ordering_data();
     void recalculate_visibility_data();
@@ -68,10 +236,20 @@ class Node {
     VerticesIndicesVectorPair recalculate_vertices_indices_data();
 
     std::optional<DrawUnitModification> calculate_draw_unit_removal() const;
-    DrawUnitModificationPack calculate_draw_unit_updates();
+    // With `defer_vertices` upsert modification is returned without
+    // vertices and indices, they have to be filled later with
+    // `calculate_draw_unit_vertices`, which is safe to run concurrently
+    // for different nodes.
+    DrawUnitModificationPack calculate_draw_unit_updates(
+        const bool defer_vertices = false
+    );
+    void calculate_draw_unit_vertices(DrawUnitModification& upsert_mod);
     void clear_draw_unit_updates(const std::optional<const DrawBucketKey> key);
 
     void set_dirty_flags(const DirtyFlagsType flags);
+    static void set_dirty_flags(
+        const std::vector<Node*>& nodes, const DirtyFlagsType flags
+    );
     void clear_dirty_flags(const DirtyFlagsType flags);
     bool query_dirty_flags(const DirtyFlagsType flags);
 
@@ -80,6 +258,9 @@ class Node {
     glm::dvec2 position();
     glm::dvec2 absolute_position();
     glm::dvec2 get_relative_position(const Node* const ancestor);
+    static std::vector<glm::dvec2> get_relative_positions(
+        const std::vector<Node*>& nodes, Node* const ancestor
+    );
     void position(const glm::dvec2& position);
 
     double rotation();
@@ -101,13 +282,16 @@ class Node {
     int16_t effective_z_index();
 
     Shape shape();
+    const ShapeHandle& shape_handle() const;
     void shape(const Shape& shape);
     void shape(const Shape& shape, bool is_auto_shape);
+    void shape(const ShapeHandle& shape, bool is_auto_shape = false);
+    void geometry_changed();
 
     Sprite sprite();
     void sprite(const Sprite& sprite);
 
-    ResourceReference<Material>& material();
+    const ResourceReference<Material>& material();
     void material(const ResourceReference<Material>& material);
 
     glm::dvec4 color();
@@ -122,6 +306,10 @@ class Node {
     Duration lifetime();
     void lifetime(const Duration lifetime);
 
+    OffscreenUpdatePolicy offscreen_update_policy() const;
+    void offscreen_update_policy(const OffscreenUpdatePolicy policy);
+    bool is_offscreen_paused() const;
+
     NodeTransitionHandle transition();
     void transition(const NodeTransitionHandle& transition);
 
@@ -150,9 +338,15 @@ class Node {
     void indexable(const bool indexable_flag);
     bool indexable() const;
 
+    void add_tag(const std::string& tag);
+    void remove_tag(const std::string& tag);
+    bool has_tag(const std::string& tag) const;
+    std::vector<std::string> tags() const;
+
     uint16_t root_distance() const;
 
     uint64_t scene_tree_id() const;
+    NodeHandle handle();
 
     BoundingBox<double> bounding_box();
 
@@ -174,6 +368,29 @@ class Node {
     template<typename Func>
     void recursive_call_downstream_children(Func&& func)
     {
+        if (auto preorder_index = this->_valid_preorder_index()) {
+            // all descendants are placed in a contiguous range
+            // right after this node
+            NodesPreorderIndex::WalkGuard guard{*preorder_index};
+            const auto& nodes = preorder_index->nodes;
+            size_t position = this->_preorder_position + 1;
+            const size_t end = this->_preorder_position + this->_subtree_size;
+            while (position < end) {
+                Node* node = nodes[position];
+                if constexpr (std::is_same_v<
+                                  std::invoke_result_t<Func, Node*>, void>) {
+                    func(node);
+                    position++;
+                } else if (not func(node)) {
+                    // skip whole subtree of this node
+                    position += node->_subtree_size;
+                } else {
+                    position++;
+                }
+            }
+            return;
+        }
+
         thread_local std::deque<Node*> nodes_to_process;
         nodes_to_process.clear();
 
@@ -287,29 +504,24 @@ class Node {
     double _rotation = 0.;
     glm::dvec2 _scale = {1., 1.};
     std::optional<int16_t> _z_index = std::nullopt;
-    Shape _shape;
+    ShapeHandle _shape = empty_shape_handle();
     bool _auto_shape = true;
     Sprite _sprite;
     glm::dvec4 _color = {1., 1., 1., 1.};
     bool _visible = true;
     Alignment _origin_alignment = Alignment::none;
     HighPrecisionDuration _lifetime = 0us;
-    NodeTransitionsManager _transitions_manager;
-    ResourceReference<Material> _material;
 
     Scene* _scene = nullptr;
     uint64_t _scene_tree_id = 0;
     Node* _parent = nullptr;
+    uint32_t _index_in_parent = 0;
     std::vector<Node*> _children;
-    std::optional<RenderPassIndexSet> _render_passes = std::nullopt;
-    std::optional<ViewportIndexSet> _viewports = std::nullopt;
     StencilMode _stencil_mode = StencilMode::make_disabled();
     uint16_t _root_distance = 0;
 
-    std::unique_ptr<ForeignNodeWrapper> _node_wrapper;
-
     struct {
-        glm::fmat4 value;
+        AffineTransformation<float> value;
     } _model_matrix;
     struct {
         RenderPassIndexSet calculated_render_passes;
@@ -333,16 +545,41 @@ class Node {
     bool _in_hitbox_chain = false;
     DirtyFlagsType _dirty_flags = DIRTY_ALL;
 
+    uint32_t _preorder_position = 0;
+    uint32_t _subtree_size = 1;
+
+    HighPrecisionDuration _lifetime_expiration = 0us;
+    uint32_t _lifetime_queue_position = NodesLifetimeQueue::unscheduled;
+    uint32_t _handle_slot = NodesHandlesRegistry::unassigned;
+
+    OffscreenUpdatePolicy _offscreen_update_policy =
+        OffscreenUpdatePolicy::always;
+    OffscreenUpdatePolicy _offscreen_pause = OffscreenUpdatePolicy::always;
+
+    std::unique_ptr<NodeColdData> _cold_data;
+
+    NodeColdData& _cold();
+    NodeTag* _find_tag(const std::string& tag) const;
     void _mark_to_delete();
-    glm::fmat4 _compute_model_matrix(const glm::fmat4& parent_matrix) const;
-    glm::fmat4 _compute_model_matrix_cumulative(
-        const Node* const ancestor = nullptr
+    bool _is_marked_subtree_root() const;
+    void _delete_children();
+    void _detach_from_parent();
+    void _enter_tree();
+    void _on_enter_scene();
+    NodesPreorderIndex* _valid_preorder_index() const;
+    AffineTransformation<float> _compute_model_matrix(
+        const AffineTransformation<float>& parent_matrix
+    ) const;
+    AffineTransformation<double> _compute_local_model_matrix() const;
+    AffineTransformation<double> _compute_relative_model_matrix(
+        const Node* const ancestor
     ) const;
     void _recalculate_model_matrix();
     void _recalculate_model_matrix_cumulative();
     void _set_position(const glm::dvec2& position);
     void _set_rotation(const double rotation);
     void _update_hitboxes();
+    void _set_offscreen_pause(const OffscreenUpdatePolicy pause);
 
     DrawBucketKey _make_draw_bucket_key() const;
 
@@ -355,6 +592,15 @@ class Node {
     friend struct HitboxNode;
     friend struct NodeSpatialData;
     friend class SpatialIndex;
+    friend struct NodesPreorderIndex;
+    friend class NodesLifetimeQueue;
+    friend class NodesGroupsIndex;
+    friend class NodesHandlesRegistry;
+    friend class NodesBatch;
+    friend class BodyNodesBatch;
+    friend class NodesSnapshotWriter;
+    friend class NodesSnapshotReader;
+    friend class TilemapNode;
     friend constexpr Node* container_node(const NodeSpatialData*);
 };
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "kaacore/node_ptr.h"
+#include "kaacore/sprites.h"
+
+namespace kaacore {
+
+class Node;
+class Scene;
+
+class NodesBatch {
+    // Reads and writes attributes of many nodes at once, values are
+    // passed in arrays matching the order of handles. Setters update
+    // all nodes first and propagate dirty flags once per batch,
+    // instead of once per node. Handles are resolved on every call,
+    // so batch can be kept between frames.
+  public:
+    NodesBatch(Scene& scene, const std::vector<NodeHandle>& handles);
+
+    size_t size() const;
+
+    std::vector<glm::dvec2> positions() const;
+    void positions(const std::vector<glm::dvec2>& positions);
+
+    std::vector<double> rotations() const;
+    void rotations(const std::vector<double>& rotations);
+
+    std::vector<glm::dvec2> scales() const;
+    void scales(const std::vector<glm::dvec2>& scales);
+
+    std::vector<glm::dvec4> colors() const;
+    void colors(const std::vector<glm::dvec4>& colors);
+
+    std::vector<bool> visible() const;
+    void visible(const std::vector<bool>& visible);
+
+    std::vector<std::optional<int16_t>> z_indices() const;
+    void z_indices(const std::vector<std::optional<int16_t>>& z_indices);
+
+    std::vector<Sprite> sprites() const;
+    void sprites(const std::vector<Sprite>& sprites);
+
+  private:
+    Scene& _scene;
+    std::vector<NodeHandle> _handles;
+
+    const std::vector<Node*>& _resolve() const;
+    void _check_values_size(const size_t size) const;
+};
+
+} // namespace kaacore
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "kaacore/clock.h"
+#include "kaacore/geometry.h"
+#include "kaacore/sprites.h"
+#include "kaacore/vertex_layout.h"
+
+namespace kaacore {
+
+// every particle is drawn as a quad and all of them have to fit
+// into single draw unit, which uses 16-bit indices
+constexpr uint32_t max_particles_per_emitter = (1u << 16) / 4;
+
+class ParticleEmitterNode {
+    // Emitter state is allocated separately, it's much bigger than
+    // other node types and would otherwise enlarge every node.
+    struct State {
+        // Particles are simulated in emitter's local space, in contiguous
+        // arrays (one entry per alive particle) instead of separate nodes.
+        // Dead particles are swapped with the last one, so the order of
+        // particles is not preserved.
+        std::vector<glm::fvec2> positions;
+        std::vector<glm::fvec2> velocities;
+        std::vector<glm::fvec4> colors;
+        std::vector<float> sizes;
+        std::vector<float> ages;
+        std::vector<float> lifetimes;
+
+        bool emitting = true;
+        double emission_rate = 0.;
+        double emission_accumulator = 0.;
+        uint32_t max_particles = 1000;
+        Duration particle_lifetime = Duration(1.);
+        Duration particle_lifetime_spread = Duration(0.);
+        glm::dvec2 initial_velocity = {0., 0.};
+        glm::dvec2 velocity_spread = {0., 0.};
+        glm::dvec2 gravity = {0., 0.};
+        glm::dvec4 start_color = {1., 1., 1., 1.};
+        glm::dvec4 end_color = {1., 1., 1., 1.};
+        double start_size = 1.;
+        double end_size = 1.;
+        std::vector<Sprite> sprite_frames;
+        std::minstd_rand random_engine;
+    };
+    std::unique_ptr<State> _state;
+
+    void _spawn_particle();
+    void _kill_particle(const size_t index);
+    void _update_appearance(const size_t index);
+    void _mark_dirty();
+
+  public:
+    ParticleEmitterNode();
+    ~ParticleEmitterNode();
+
+    void step(const HighPrecisionDuration dt);
+    void emit(const uint32_t count);
+    void clear();
+    void seed(const uint32_t seed);
+
+    size_t particles_count() const;
+    const std::vector<glm::fvec2>& positions() const;
+    const std::vector<glm::fvec2>& velocities() const;
+    const std::vector<glm::fvec4>& colors() const;
+    const std::vector<float>& sizes() const;
+    const std::vector<float>& ages() const;
+
+    VerticesIndicesVectorPair make_vertices_indices(
+        const AffineTransformation<float>& model_matrix,
+        const glm::fvec4& color
+    ) const;
+
+    bool emitting() const;
+    void emitting(const bool emitting);
+
+    double emission_rate() const;
+    void emission_rate(const double emission_rate);
+
+    uint32_t max_particles() const;
+    void max_particles(const uint32_t max_particles);
+
+    Duration particle_lifetime() const;
+    void particle_lifetime(const Duration particle_lifetime);
+
+    Duration particle_lifetime_spread() const;
+    void particle_lifetime_spread(const Duration particle_lifetime_spread);
+
+    glm::dvec2 initial_velocity() const;
+    void initial_velocity(const glm::dvec2& initial_velocity);
+
+    glm::dvec2 velocity_spread() const;
+    void velocity_spread(const glm::dvec2& velocity_spread);
+
+    glm::dvec2 gravity() const;
+    void gravity(const glm::dvec2& gravity);
+
+    glm::dvec4 start_color() const;
+    void start_color(const glm::dvec4& start_color);
+
+    glm::dvec4 end_color() const;
+    void end_color(const glm::dvec4& end_color);
+
+    double start_size() const;
+    void start_size(const double start_size);
+
+    double end_size() const;
+    void end_size(const double end_size);
+
+    const std::vector<Sprite>& sprite_frames() const;
+    void sprite_frames(const std::vector<Sprite>& sprite_frames);
+};
+
+} // namespace kaacore
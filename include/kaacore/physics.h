@@ -29,6 +29,7 @@ typedef std::unique_ptr<cpShape, void (*)(cpShape*)> CpShapeUniquePtr;
 constexpr HighPrecisionDuration default_simulation_step_size = 10000us; // 0.01s
 
 class Node;
+class Scene;
 class SpaceNode;
 class BodyNode;
 class HitboxNode;
@@ -294,11 +295,47 @@ class BodyNode {
     friend class Node;
     friend class HitboxNode;
     friend class Scene;
+    friend class BodyNodesBatch;
 
     friend void _velocity_update_wrapper(cpBody*, cpVect, cpFloat, cpFloat);
     friend void _position_update_wrapper(cpBody*, cpFloat);
 };
 
+class BodyNodesBatch {
+    // Reads and writes simulation state of many body nodes at once,
+    // values are passed in arrays matching the order of handles.
+    // Handles are resolved and validated once per call,
+    // then chipmunk bodies are accessed directly.
+  public:
+    BodyNodesBatch(Scene& scene, const std::vector<NodeHandle>& handles);
+
+    size_t size() const;
+
+    std::vector<glm::dvec2> positions() const;
+    void positions(const std::vector<glm::dvec2>& positions);
+
+    std::vector<glm::dvec2> velocities() const;
+    void velocities(const std::vector<glm::dvec2>& velocities);
+
+    std::vector<double> angular_velocities() const;
+    void angular_velocities(const std::vector<double>& angular_velocities);
+
+    std::vector<glm::dvec2> forces() const;
+    void forces(const std::vector<glm::dvec2>& forces);
+
+    std::vector<bool> sleeping() const;
+    void sleeping(const std::vector<bool>& sleeping);
+
+    void apply_impulses(const std::vector<glm::dvec2>& impulses);
+
+  private:
+    Scene& _scene;
+    std::vector<NodeHandle> _handles;
+
+    const std::vector<BodyNode*>& _resolve() const;
+    void _check_values_size(const size_t size) const;
+};
+
 CpShapeUniquePtr
 prepare_hitbox_shape(const Shape& shape, const Transformation& transformtion);
 
@@ -335,12 +372,14 @@ class HitboxNode {
     ~HitboxNode();
 
     void update_physics_shape();
+    void prepare_physics_shape();
     void attach_to_simulation();
     void detach_from_simulation();
     void _mark_hitbox_chain();
     Node* _find_nearest_parent(const NodeType type) const;
 
     cpShape* _cp_shape = nullptr;
+    Transformation _cp_shape_transformation;
 
     friend class Node;
 };
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
 #include <memory>
+#include <optional>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -15,6 +18,7 @@
 #include "kaacore/render_passes.h"
 #include "kaacore/renderer.h"
 #include "kaacore/spatial_index.h"
+#include "kaacore/streaming.h"
 #include "kaacore/timers.h"
 #include "kaacore/viewports.h"
 
@@ -28,6 +32,7 @@ class Scene {
     RenderPassesManager render_passes;
     ViewportsManager viewports;
     TimersManager timers;
+    StreamingManager streaming;
     SpatialIndex spatial_index;
     std::set<Node*> simulations_registry;
     DrawQueue draw_queue;
@@ -54,8 +59,19 @@ class Scene {
     void unregister_simulation(Node* node);
 
     void handle_add_node_to_tree(Node* node);
+    void handle_add_nodes_to_tree(const std::vector<Node*>& nodes);
     void handle_remove_node_from_tree(Node* node);
 
+    NodePtr resolve(const NodeHandle& handle) const;
+
+    const std::vector<Node*>& group(const std::string& tag) const;
+    size_t group_size(const std::string& tag) const;
+    void delete_group(const std::string& tag);
+    void set_group_visible(const std::string& tag, const bool visible);
+    void set_group_z_index(
+        const std::string& tag, const std::optional<int16_t>& z_index
+    );
+
     Camera& camera();
     Duration total_time() const;
 
@@ -77,9 +93,21 @@ class Scene {
     NodesQueue _nodes_remove_queue;
     std::vector<DrawCommand> _draw_commands;
     std::atomic<uint64_t> _node_scene_tree_id_counter = 0;
+    NodesPreorderIndex _nodes_preorder_index;
+    NodesLifetimeQueue _nodes_lifetime_queue;
+    NodesGroupsIndex _nodes_groups_index;
+    NodesHandlesRegistry _nodes_handles_registry;
+
+    using VisibleAreasCache =
+        std::array<std::optional<BoundingBox<double>>, KAACORE_MAX_VIEWPORTS>;
 
     void _reset();
+    void _resolve_offscreen_pauses(const NodesQueue& processing_queue);
+    bool _is_subtree_visible(
+        Node* const subtree_root, VisibleAreasCache& visible_areas
+    );
 
+    friend class Node;
     friend class Engine;
     friend class Renderer;
 };
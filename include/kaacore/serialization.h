@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kaacore/node_ptr.h"
+
+namespace kaacore {
+
+class Node;
+
+// Nodes snapshot is a compact binary representation of a node subtree,
+// nodes are stored in pre-order, each one followed by its children.
+// Snapshot uses native byte order and is not meant to be portable
+// between platforms with different endianness.
+constexpr uint32_t nodes_snapshot_magic = 0x4e414b53; // "SKAN"
+constexpr uint16_t nodes_snapshot_version = 1;
+
+std::vector<uint8_t>
+serialize_nodes(Node* const root);
+NodeOwnerPtr
+deserialize_nodes(const uint8_t* data, const size_t size);
+
+void
+save_nodes(Node* const root, const std::string& path);
+NodeOwnerPtr
+load_nodes(const std::string& path);
+
+} // namespace kaacore
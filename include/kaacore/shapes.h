@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -11,6 +12,24 @@
 
 namespace kaacore {
 
+class Camera;
+
+// circles use fixed segments count by default, adaptive variants
+// are tessellated so that the distance between generated edges
+// and the actual circle doesn't exceed max radial error
+constexpr uint32_t default_circle_segments_count = 24;
+constexpr double default_circle_max_radial_error = 0.25;
+constexpr uint32_t min_circle_segments_count = 8;
+constexpr uint32_t max_circle_segments_count = 512;
+
+uint32_t
+circle_segments_count(
+    const double radius,
+    const double max_radial_error = default_circle_max_radial_error
+);
+double
+circle_radial_error(const double radius, const uint32_t segments_count);
+
 enum struct ShapeType {
     none = 0,
     segment,
@@ -19,6 +38,17 @@ enum struct ShapeType {
     freeform,
 };
 
+struct GeometryBuffer {
+    // Vertices and indices owned by the caller, freeform shapes created
+    // from it keep only a reference instead of a copy, so procedural
+    // geometry can be modified in place. Nodes using such shape have to
+    // be notified about modifications with `Node::geometry_changed`.
+    std::vector<VertexIndex> indices;
+    std::vector<StandardVertexData> vertices;
+};
+
+using GeometryBufferHandle = std::shared_ptr<GeometryBuffer>;
+
 struct Shape {
     ShapeType type;
     std::vector<glm::dvec2> points;
@@ -28,6 +58,7 @@ struct Shape {
     std::vector<StandardVertexData> vertices;
     BoundingBox<double> vertices_bbox;
     std::vector<glm::dvec2> bounding_points;
+    GeometryBufferHandle geometry;
 
     Shape() : type(ShapeType::none){};
     Shape(
@@ -45,12 +76,34 @@ struct Shape {
     );
 
     inline operator bool() const { return this->type != ShapeType::none; }
-    bool operator==(const Shape& other);
+    bool operator==(const Shape& other) const;
     BoundingBox<double> bounding_box() const;
+    const std::vector<VertexIndex>& get_indices() const;
+    const std::vector<StandardVertexData>& get_vertices() const;
 
     static Shape Segment(const glm::dvec2 a, const glm::dvec2 b);
+    static Shape Circle(
+        const double radius, const glm::dvec2 center,
+        const uint32_t segments_count
+    );
+    static Shape Circle(
+        const double radius, const glm::dvec2 center, const Camera& camera
+    );
     static Shape Circle(const double radius, const glm::dvec2 center);
     static Shape Circle(const double radius);
+    static Shape AdaptiveCircle(
+        const double radius, const glm::dvec2 center,
+        const double max_radial_error = default_circle_max_radial_error
+    );
+    static Shape Ellipse(
+        const glm::dvec2 radii, const glm::dvec2 center,
+        const uint32_t segments_count
+    );
+    static Shape Ellipse(
+        const glm::dvec2 radii, const glm::dvec2 center, const Camera& camera
+    );
+    static Shape Ellipse(const glm::dvec2 radii, const glm::dvec2 center);
+    static Shape Ellipse(const glm::dvec2 radii);
     static Shape Box(const glm::dvec2 size);
     static Shape Polygon(const std::vector<glm::dvec2>& points);
     static Shape Freeform(
@@ -62,6 +115,11 @@ struct Shape {
         const std::vector<StandardVertexData>& vertices,
         const BoundingBox<double> bounding_box
     );
+    static Shape Freeform(const GeometryBufferHandle& geometry);
+    static Shape Freeform(
+        const GeometryBufferHandle& geometry,
+        const BoundingBox<double> bounding_box
+    );
 
     Shape transform(const Transformation& transformation) const;
     bool contains_point(const glm::dvec2 point) const;
@@ -94,8 +152,24 @@ struct hash<Shape> {
                 std::vector<StandardVertexData>::const_iterator>(
                 shape.vertices.begin(), shape.vertices.end()
             ),
-            shape.radius
+            shape.radius, shape.geometry.get()
         );
     }
 };
 } // namespace std
+
+namespace kaacore {
+
+// Shapes stored by nodes are immutable and interned by content,
+// so identical shapes share the same buffers and can be compared
+// by pointer. Interned shape is released together with its last handle.
+using ShapeHandle = std::shared_ptr<const Shape>;
+
+ShapeHandle
+intern_shape(const Shape& shape);
+const ShapeHandle&
+empty_shape_handle();
+size_t
+interned_shapes_count();
+
+} // namespace kaacore
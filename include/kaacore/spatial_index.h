@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 #include <chipmunk/chipmunk.h>
@@ -19,32 +24,146 @@ struct NodeSpatialData {
     std::vector<glm::dvec2> bounding_points_transformed;
 
     void refresh();
+    // doesn't modify spatial data, transformed
+    // bounding points are stored in the given buffer
+    BoundingBox<double> calculate_bounding_box(
+        std::vector<glm::dvec2>& bounding_points
+    ) const;
     bool contains_point(const glm::dvec2 point) const;
 };
 
+enum struct SpatialIndexBackend : uint8_t {
+    bb_tree = 1,
+    spatial_hash = 2,
+    sweep_and_prune = 3,
+};
+
+constexpr uint32_t default_spatial_hash_cells_count = 1000;
+
+// Non-owning reference to a callable with `bool(NodePtr)` signature,
+// returning false stops the query. Unlike std::function it never
+// allocates, referenced callable must outlive the query.
+class SpatialQueryCallback {
+  public:
+    template<
+        typename Callable,
+        typename = std::enable_if_t<
+            std::is_invocable_r_v<bool, Callable&, NodePtr> and
+            not std::is_same_v<std::decay_t<Callable>, SpatialQueryCallback>>>
+    SpatialQueryCallback(Callable&& callable)
+        : _callable(const_cast<void*>(
+              static_cast<const void*>(std::addressof(callable))
+          )),
+          _invoke([](void* callable, NodePtr node) -> bool {
+              return (*static_cast<std::remove_reference_t<Callable>*>(
+                  callable
+              ))(node);
+          })
+    {}
+
+    bool operator()(NodePtr node) const
+    {
+        return this->_invoke(this->_callable, node);
+    }
+
+  private:
+    void* _callable;
+    bool (*_invoke)(void*, NodePtr);
+};
+
+struct SpatialQueryResult {
+    NodePtr node;
+    // segment queries: point where segment enters node's shape,
+    // nearest queries: point of node's shape closest to queried point
+    glm::dvec2 point;
+    double distance;
+};
+
 class SpatialIndex {
   public:
     SpatialIndex();
     ~SpatialIndex();
+    SpatialIndex(const SpatialIndex&) = delete;
+    SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+    SpatialIndexBackend backend() const;
+    // Dynamic AABB tree, a good default for objects of varying sizes.
+    void use_bb_tree();
+    // Uniform grid, suits densely packed objects of similar size,
+    // `cell_size` should be close to the size of a typical object.
+    void use_spatial_hash(
+        const double cell_size,
+        const uint32_t cells_count = default_spatial_hash_cells_count
+    );
+    // Objects kept in a flat array, checked along x axis first. Cheapest
+    // to insert, but queries are linear and any update rebuilds whole
+    // array at the end of the frame, so it suits small or mostly static
+    // sets of objects.
+    void use_sweep_and_prune();
 
     void start_tracking(Node* node);
+    // Inserts indexable nodes in a single pass, BB tree is rebuilt
+    // once afterwards if the batch is larger than the existing index.
+    void start_tracking(const std::vector<Node*>& nodes);
     void stop_tracking(Node* node);
     void update_single(Node* node);
+    // Sweep and prune backend caches bounds of the objects and has
+    // no way to refresh a single one, so updated nodes are only marked
+    // and whole index is rebuilt here, once per frame.
+    void flush_updates();
     std::vector<NodePtr> query_bounding_box(
         const BoundingBox<double>& bbox, bool include_shapeless = true
     );
     std::vector<NodePtr> query_point(const glm::dvec2 point);
 
+    // Overloads for frequent queries, they don't allocate:
+    // results buffer is cleared and refilled (keeping its capacity)
+    // or each result is passed to callback, in no particular order.
+    void query_bounding_box(
+        const BoundingBox<double>& bbox, std::vector<NodePtr>& results,
+        bool include_shapeless = true
+    );
+    void query_bounding_box(
+        const BoundingBox<double>& bbox, const SpatialQueryCallback& callback,
+        bool include_shapeless = true
+    );
+    void query_point(const glm::dvec2 point, std::vector<NodePtr>& results);
+    void query_point(
+        const glm::dvec2 point, const SpatialQueryCallback& callback
+    );
+
+    // Nodes with shapes crossed by the segment, ordered by distance
+    // from its start (0 if it starts inside), shapeless nodes are skipped.
+    std::vector<SpatialQueryResult> query_segment(
+        const glm::dvec2 start, const glm::dvec2 end
+    );
+    std::vector<SpatialQueryResult> query_ray(
+        const glm::dvec2 origin, const glm::dvec2 direction,
+        const double max_distance
+    );
+    // Up to `count` nodes closest to the point, ordered by distance
+    // to their shapes (0 if point is inside).
+    std::vector<SpatialQueryResult> query_nearest(
+        const glm::dvec2 point, const size_t count,
+        const double max_distance = std::numeric_limits<double>::infinity(),
+        bool include_shapeless = true
+    );
+
   private:
-    std::vector<NodeSpatialData*> _query_wrappers(
-        const BoundingBox<double>& bbox
+    template<typename Visitor>
+    void _query_wrappers(const BoundingBox<double>& bbox, Visitor&& visitor);
+    void _sort_query_results(std::vector<SpatialQueryResult>& results);
+    void _replace_cp_index(
+        cpSpatialIndex* cp_index, const SpatialIndexBackend backend
     );
     void _add_to_cp_index(Node* node);
     void _update_cp_index(Node* node);
     void _remove_from_cp_index(Node* node);
 
     cpSpatialIndex* _cp_index;
+    SpatialIndexBackend _backend;
     uint64_t _index_counter;
+    bool _has_stale_bounds;
 };
 
 } // namespace kaacore
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "kaacore/clock.h"
+#include "kaacore/geometry.h"
+#include "kaacore/node_ptr.h"
+#include "kaacore/viewports.h"
+
+namespace kaacore {
+
+class Scene;
+
+enum struct StreamingCellState : uint8_t {
+    inactive = 0,
+    loading = 1,
+    active = 2,
+    unloading = 3,
+};
+
+using StreamingLoadCallback = std::function<NodeOwnerPtr(const glm::ivec2)>;
+using StreamingUnloadCallback =
+    std::function<void(const glm::ivec2, NodePtr)>;
+
+class StreamingManager {
+    // Splits the world into square cells of `cell_size` and keeps
+    // subtrees of cells near cameras of selected viewports attached.
+    // Cell is queued for loading once it gets within
+    // `activation_distance` from any camera and queued for unloading
+    // once all cameras are farther than `deactivation_distance`,
+    // gap between the two prevents churn at cells borders.
+    // Queued operations are executed in `process()` until frame budget
+    // is used up (at least one per frame), unloads go first, then loads
+    // of cells closest to cameras.
+  public:
+    StreamingManager(Scene* const scene);
+    StreamingManager(const StreamingManager&) = delete;
+    StreamingManager& operator=(const StreamingManager&) = delete;
+
+    // loader returns subtree of given cell (possibly empty), it's
+    // attached to scene's root, unloader is called before it's destroyed
+    void loader(StreamingLoadCallback callback);
+    void unloader(StreamingUnloadCallback callback);
+
+    glm::dvec2 cell_size() const;
+    void cell_size(const glm::dvec2& size);
+
+    double activation_distance() const;
+    double deactivation_distance() const;
+    void distances(const double activation, const double deactivation);
+
+    Duration frame_budget() const;
+    void frame_budget(const Duration budget);
+
+    std::vector<int16_t> viewports() const;
+    void viewports(const std::vector<int16_t>& viewports);
+
+    glm::ivec2 cell_at(const glm::dvec2 position) const;
+    BoundingBox<double> cell_bounds(const glm::ivec2 cell) const;
+    StreamingCellState cell_state(const glm::ivec2 cell) const;
+    NodePtr cell_root(const glm::ivec2 cell) const;
+    std::vector<glm::ivec2> active_cells() const;
+    size_t pending_operations_count() const;
+
+    void process();
+    // unloads all cells immediately, ignoring frame budget
+    void clear();
+
+  private:
+    struct _Cell {
+        StreamingCellState state = StreamingCellState::inactive;
+        NodeHandle root;
+    };
+
+    Scene* const _scene;
+    StreamingLoadCallback _loader;
+    StreamingUnloadCallback _unloader;
+    glm::dvec2 _cell_size = {512., 512.};
+    double _activation_distance = 512.;
+    double _deactivation_distance = 1024.;
+    Duration _frame_budget = 2ms;
+    std::vector<int16_t> _viewports = {default_viewport_z_index};
+    std::unordered_map<glm::ivec2, _Cell> _cells;
+
+    void _update_cells_states(const std::vector<glm::dvec2>& focus_points);
+    double _cell_distance(
+        const glm::ivec2 cell, const std::vector<glm::dvec2>& focus_points
+    ) const;
+    void _load_cell(const glm::ivec2 cell, _Cell& cell_data);
+    void _unload_cell(const glm::ivec2 cell, _Cell& cell_data);
+};
+
+} // namespace kaacore
@@ -1,11 +1,14 @@
-#include <exception>
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <future>
 #include <initializer_list>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include "kaacore/log.h"
@@ -110,4 +113,50 @@ class AwaitableStateEnum {
     std::mutex _mutex;
 };
 
+class WorkersPool {
+    // Persistent threads for splitting data-parallel work within a frame,
+    // calling thread processes ranges as well.
+  public:
+    using RangeFunction = std::function<void(size_t, size_t)>;
+
+    WorkersPool(const size_t workers_count);
+    ~WorkersPool();
+    WorkersPool(const WorkersPool&) = delete;
+    WorkersPool& operator=(const WorkersPool&) = delete;
+
+    size_t workers_count() const;
+
+    // Calls `func(begin, end)` for consecutive ranges covering
+    // [0, count), each at least `min_range_size` long, and blocks until
+    // all of them are done. Ranges are not ordered, func must only touch
+    // data belonging to its range. First thrown exception is rethrown.
+    void parallel_for(
+        const size_t count, const size_t min_range_size,
+        const RangeFunction& func
+    );
+
+  private:
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _work_condition_var;
+    std::condition_variable _done_condition_var;
+    bool _stopping = false;
+    uint64_t _generation = 0;
+    size_t _active_workers = 0;
+
+    const RangeFunction* _func = nullptr;
+    size_t _count = 0;
+    size_t _range_size = 0;
+    size_t _ranges_count = 0;
+    size_t _finished_ranges = 0;
+    std::atomic<size_t> _next_range = 0;
+    std::exception_ptr _exception;
+
+    void _worker_entrypoint();
+    void _process_ranges();
+};
+
+size_t
+default_workers_count();
+
 } // namespace kaacore
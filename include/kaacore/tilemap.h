@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "kaacore/sprites.h"
+
+namespace kaacore {
+
+class Node;
+
+using TileId = uint16_t;
+constexpr TileId empty_tile = std::numeric_limits<TileId>::max();
+
+// all tiles of a chunk are drawn as a single draw unit,
+// which uses 16-bit indices (4 vertices per tile)
+constexpr uint32_t max_tilemap_chunk_size = 128;
+
+class TilemapNode {
+    // Tiles are stored in square chunks of `chunk_size` tiles, each chunk
+    // is drawn by its own child node with a single mesh built from
+    // the atlas. Mesh is rebuilt only for chunks modified since the last
+    // rebuild, which happens before the tilemap is drawn.
+    // Tile ID is an index of atlas frame (row-major order).
+    struct Chunk {
+        std::vector<TileId> tiles;
+        uint32_t tiles_count = 0;
+        Node* node = nullptr;
+        bool is_dirty = false;
+    };
+
+    Sprite _atlas;
+    glm::dvec2 _tile_size;
+    uint32_t _chunk_size;
+    std::unordered_map<glm::ivec2, Chunk> _chunks;
+    std::vector<glm::ivec2> _dirty_chunks;
+
+    Chunk& _get_or_create_chunk(const glm::ivec2 chunk_position);
+    void _mark_chunk_dirty(const glm::ivec2 chunk_position, Chunk& chunk);
+    void _mark_all_chunks_dirty();
+    void _rebuild_chunk(Chunk& chunk);
+    void _destroy_chunk_node(Node* chunk_node);
+    glm::dvec2 _chunk_origin(const glm::ivec2 chunk_position) const;
+
+  public:
+    TilemapNode();
+    ~TilemapNode();
+
+    Sprite atlas() const;
+    void atlas(const Sprite& atlas);
+
+    glm::dvec2 tile_size() const;
+    void tile_size(const glm::dvec2 tile_size);
+
+    uint32_t chunk_size() const;
+    void chunk_size(const uint32_t chunk_size);
+
+    TileId tile(const glm::ivec2 tile_position) const;
+    void tile(const glm::ivec2 tile_position, const TileId tile_id);
+    void fill(
+        const glm::ivec2 first_tile_position,
+        const glm::ivec2 last_tile_position, const TileId tile_id
+    );
+    void clear();
+
+    glm::ivec2 tile_position_at(const glm::dvec2 position) const;
+    TileId tile_at(const glm::dvec2 position) const;
+
+    glm::ivec2 chunk_position(const glm::ivec2 tile_position) const;
+    std::vector<glm::ivec2> chunks_positions() const;
+    const std::vector<TileId>& chunk_tiles(const glm::ivec2 chunk_position
+    ) const;
+    void chunk_tiles(
+        const glm::ivec2 chunk_position, const std::vector<TileId>& tiles
+    );
+    Node* chunk_node(const glm::ivec2 chunk_position) const;
+    size_t chunks_count() const;
+    size_t dirty_chunks_count() const;
+    void rebuild_dirty_chunks();
+};
+
+} // namespace kaacore
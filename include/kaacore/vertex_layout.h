@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <utility>
 #include <vector>
 
@@ -63,4 +64,24 @@ struct StandardVertexData {
         );
     }
 };
+
+// Parameters of vertices transformation in the 2D affine case:
+// positions are transformed by (x_axis, y_axis, translation) basis,
+// z and mn coordinates are passed through, uvs are remapped
+// with `uv_origin + uv * uv_span` and all colors are set to `color`.
+struct VertexTransformParams {
+    glm::fvec2 x_axis = {1., 0.};
+    glm::fvec2 y_axis = {0., 1.};
+    glm::fvec2 translation = {0., 0.};
+    glm::fvec2 uv_origin = {0., 0.};
+    glm::fvec2 uv_span = {0., 0.};
+    glm::fvec4 color = {1., 1., 1., 1.};
+};
+
+void
+transform_vertices(
+    const StandardVertexData* source, StandardVertexData* destination,
+    const size_t count, const VertexTransformParams& params
+);
+
 } // namespace kaacore
@@ -149,6 +149,7 @@ Engine::Engine(
 
     this->input_manager = std::make_unique<InputManager>();
     this->audio_manager = std::make_unique<AudioManager>();
+    this->workers_pool = std::make_unique<WorkersPool>(default_workers_count());
 #if KAACORE_MULTITHREADING_MODE
     bgfx::renderFrame(); // This marks main thread as "rendering thread"
                          // meaning it will talk with system graphics.
@@ -223,6 +224,7 @@ Engine::~Engine()
     this->renderer.reset();
 #endif
 
+    this->workers_pool.reset();
     this->window.reset();
     SDL_Quit();
     engine = nullptr;
@@ -430,6 +432,7 @@ Engine::_scene_processing()
                 this->_event_processing_state.set(EventProcessingState::consumed
                 );
 #endif
+                this->_scene->streaming.process();
                 const auto& nodes_processing_queue =
                     this->_scene->build_processing_queue();
                 this->_scene->update_nodes_drawing_queue(nodes_processing_queue
@@ -5,6 +5,16 @@
 
 #include "kaacore/files.h"
 
+#if defined(__unix__) or defined(__APPLE__)
+#define KAACORE_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define KAACORE_HAS_MMAP 0
+#endif
+
 namespace kaacore {
 
 File::File(const std::string& path) noexcept(false) : path(path)
@@ -20,4 +30,64 @@ File::File(const std::string& path) noexcept(false) : path(path)
     this->content.resize(len);
     f.read(reinterpret_cast<char*>(this->content.data()), len);
 }
+
+MappedFile::MappedFile(const std::string& path) noexcept(false)
+    : path(path), _data(nullptr), _size(0), _is_mapped(false)
+{
+    KAACORE_LOG_INFO("Mapping file: {}", path);
+#if KAACORE_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::ios_base::failure("Failed to open file: " + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 and file_stat.st_size > 0) {
+        void* mapped = mmap(
+            nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0
+        );
+        if (mapped != MAP_FAILED) {
+            this->_data = static_cast<const uint8_t*>(mapped);
+            this->_size = file_stat.st_size;
+            this->_is_mapped = true;
+        }
+    }
+    close(fd);
+    if (this->_is_mapped) {
+        return;
+    }
+    KAACORE_LOG_DEBUG("Failed to map file, reading it instead: {}", path);
+#endif
+    File file{path};
+    this->_content = std::move(file.content);
+    this->_data = this->_content.data();
+    this->_size = this->_content.size();
+}
+
+MappedFile::~MappedFile()
+{
+#if KAACORE_HAS_MMAP
+    if (this->_is_mapped) {
+        munmap(const_cast<uint8_t*>(this->_data), this->_size);
+    }
+#endif
+}
+
+const uint8_t*
+MappedFile::data() const
+{
+    return this->_data;
+}
+
+size_t
+MappedFile::size() const
+{
+    return this->_size;
+}
+
+bool
+MappedFile::is_mapped() const
+{
+    return this->_is_mapped;
+}
+
 } // namespace kaacore
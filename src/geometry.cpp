@@ -12,38 +12,52 @@
 
 namespace kaacore {
 
-Transformation::Transformation() : Transformation(glm::dmat4(1.)) {}
+Transformation::Transformation() {}
 
-Transformation::Transformation(const glm::dmat4& matrix) : _matrix(matrix) {}
+Transformation::Transformation(const glm::dmat4& matrix)
+    : _transformation(matrix)
+{}
+
+Transformation::Transformation(
+    const AffineTransformation<double>& transformation
+)
+    : _transformation(transformation)
+{}
 
 bool
 Transformation::operator==(const Transformation& other) const
 {
-    return this->_matrix == other._matrix;
+    return this->_transformation == other._transformation;
 }
 
 Transformation
 Transformation::translate(const glm::dvec2& tr)
 {
-    return Transformation{glm::translate(glm::dvec3(tr.x, tr.y, 0.))};
+    return Transformation{
+        AffineTransformation<double>{{1., 0.}, {0., 1.}, tr}
+    };
 }
 
 Transformation
 Transformation::scale(const glm::dvec2& sc)
 {
-    return Transformation{glm::scale(glm::dvec3(sc.x, sc.y, 1.))};
+    return Transformation{
+        AffineTransformation<double>{{sc.x, 0.}, {0., sc.y}, {0., 0.}}
+    };
 }
 
 Transformation
 Transformation::rotate(const double& r)
 {
-    return Transformation{glm::rotate(r, glm::dvec3(0., 0., 1.))};
+    return Transformation{
+        AffineTransformation<double>::from_components({0., 0.}, r, {1., 1.})
+    };
 }
 
 Transformation
 Transformation::inverse() const
 {
-    return Transformation{glm::inverse(this->_matrix)};
+    return Transformation{this->_transformation.inverse()};
 }
 
 double
@@ -51,38 +65,51 @@ Transformation::at(const size_t col, const size_t row) const
 {
     KAACORE_ASSERT(col < 4 and col >= 0, "Invalid col parameter.");
     KAACORE_ASSERT(row < 4 and row >= 0, "Invalid row parameter.");
-    return this->_matrix[col][row];
+    return this->_transformation.to_mat4()[col][row];
 }
 
 const DecomposedTransformation<double>
 Transformation::decompose() const
 {
-    return DecomposedTransformation<double>{this->_matrix};
+    return DecomposedTransformation<double>{this->_transformation};
+}
+
+const AffineTransformation<double>&
+Transformation::affine() const
+{
+    return this->_transformation;
+}
+
+glm::dmat4
+Transformation::matrix() const
+{
+    return this->_transformation.to_mat4();
 }
 
 Transformation
 operator|(const Transformation& left, const Transformation& right)
 {
-    return Transformation{right._matrix * left._matrix};
+    return Transformation{right._transformation * left._transformation};
 }
 
 glm::dvec2
 operator|(const glm::dvec2& position, const Transformation& transformation)
 {
-    return transformation._matrix * glm::dvec4(position, 0., 1.);
+    return transformation._transformation.apply(position);
 }
 
 Transformation&
 operator|=(Transformation& transformation, const Transformation& other)
 {
-    transformation = Transformation{other._matrix * transformation._matrix};
+    transformation._transformation =
+        other._transformation * transformation._transformation;
     return transformation;
 }
 
 glm::dvec2&
 operator|=(glm::dvec2& position, const Transformation& transformation)
 {
-    position = transformation._matrix * glm::dvec4(position, 0., 1.);
+    position = transformation._transformation.apply(position);
     return position;
 }
 
@@ -167,7 +194,7 @@ check_point_in_polygon(
     }
 
     int turn = 0;
-    for (size_t i; i < points_count; i++) {
+    for (size_t i = 0; i < points_count; i++) {
         const auto& pt1 = polygon_points[i];
         const auto& pt2 = polygon_points[(i + 1) % points_count];
 
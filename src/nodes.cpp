@@ -2,7 +2,9 @@
 #include <cmath>
 #include <functional>
 #include <optional>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -37,24 +39,29 @@ Node::Node(NodeType type) : _type(type)
     } else if (type == NodeType::text) {
         new (&this->text) TextNode();
         this->_origin_alignment = Alignment::center;
+    } else if (type == NodeType::particle_emitter) {
+        new (&this->particle_emitter) ParticleEmitterNode();
+    } else if (type == NodeType::tilemap) {
+        new (&this->tilemap) TilemapNode();
     }
 }
 
 Node::~Node()
 {
     KAACORE_LOG_DEBUG("Destroying node: {}", fmt::ptr(this));
-    if (this->_parent != nullptr) {
-        auto pos_in_parent = std::find(
-            this->_parent->_children.begin(), this->_parent->_children.end(),
-            this
-        );
-        if (pos_in_parent != this->_parent->_children.end()) {
-            this->_parent->_children.erase(pos_in_parent);
-        }
-    }
+    // Erasing node from parent's children would be linear in siblings
+    // count, so nodes are always detached by whoever deletes them:
+    // remove_marked_nodes compacts children of every parent once per
+    // frame and _delete_children drops the whole children vector.
+    KAACORE_ASSERT_TERMINATE(
+        this->_parent == nullptr, "Node ({}) is deleted while attached.",
+        fmt::ptr(this)
+    );
+
+    this->_delete_children();
 
-    while (not this->_children.empty()) {
-        delete this->_children[0];
+    if (this->_lifetime_queue_position != NodesLifetimeQueue::unscheduled) {
+        this->_scene->_nodes_lifetime_queue.unschedule(this);
     }
 
     if (this->_type == NodeType::space) {
@@ -68,7 +75,20 @@ Node::~Node()
         this->hitbox.~HitboxNode();
     } else if (this->_type == NodeType::text) {
         this->text.~TextNode();
+    } else if (this->_type == NodeType::particle_emitter) {
+        this->particle_emitter.~ParticleEmitterNode();
+    } else if (this->_type == NodeType::tilemap) {
+        this->tilemap.~TilemapNode();
+    }
+}
+
+NodeColdData&
+Node::_cold()
+{
+    if (not this->_cold_data) {
+        this->_cold_data = std::make_unique<NodeColdData>();
     }
+    return *this->_cold_data;
 }
 
 void
@@ -80,8 +100,8 @@ Node::_mark_to_delete()
     KAACORE_LOG_DEBUG("Marking node to delete: {}", fmt::ptr(this));
     KAACORE_ASSERT(this->_scene != nullptr, "Node not attached to the tree.");
     this->_marked_to_delete = true;
-    if (this->_node_wrapper) {
-        this->_node_wrapper->on_detach();
+    if (auto wrapper = this->wrapper_ptr()) {
+        wrapper->on_detach();
     }
     this->_scene->handle_remove_node_from_tree(this);
     // TODO ensure that parent can't access the removed node
@@ -99,38 +119,151 @@ Node::_mark_to_delete()
     }
 }
 
-glm::fmat4
-Node::_compute_model_matrix(const glm::fmat4& parent_matrix) const
+bool
+Node::_is_marked_subtree_root() const
+{
+    // Checks if node is the top-most node marked to delete
+    // on its path to the root, deleting such node also deletes
+    // all of the other marked nodes in its subtree.
+    if (not this->_marked_to_delete or this->_parent == nullptr) {
+        return false;
+    }
+    for (const Node* node = this->_parent; node != nullptr;
+         node = node->_parent) {
+        if (node->_marked_to_delete) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+Node::_delete_children()
+{
+    // detach all children at once, so they won't
+    // have to remove themselves from parent one by one
+    std::vector<Node*> children;
+    std::swap(children, this->_children);
+    for (Node* child : children) {
+        child->_parent = nullptr;
+        delete child;
+    }
+}
+
+void
+Node::_detach_from_parent()
+{
+    // For nodes outside of the scene, which are deleted right away,
+    // nodes in the tree are detached in bulk by remove_marked_nodes.
+    // Siblings order is not kept, the last sibling takes over the slot.
+    KAACORE_ASSERT(
+        this->_scene == nullptr, "Node ({}) is in the tree.", fmt::ptr(this)
+    );
+    if (this->_parent == nullptr) {
+        return;
+    }
+    auto& siblings = this->_parent->_children;
+    KAACORE_ASSERT(
+        this->_index_in_parent < siblings.size() and
+            siblings[this->_index_in_parent] == this,
+        "Invalid index in parent's children of node: {}", fmt::ptr(this)
+    );
+    Node* last_sibling = siblings.back();
+    siblings[this->_index_in_parent] = last_sibling;
+    last_sibling->_index_in_parent = this->_index_in_parent;
+    siblings.pop_back();
+    this->_parent = nullptr;
+}
+
+void
+Node::_enter_tree()
 {
-    return glm::scale(
-        glm::rotate(
-            glm::translate(
-                parent_matrix,
-                glm::fvec3(this->_position.x, this->_position.y, 0.)
-            ),
-            static_cast<float>(this->_rotation), glm::fvec3(0., 0., 1.)
-        ),
-        glm::fvec3(this->_scale.x, this->_scale.y, 1.)
+    // Whole subtree is collected first, so when it enters the scene
+    // all of its nodes are registered in a single batch.
+    Scene* scene = this->_parent->_scene;
+    KAACORE_ASSERT(
+        this->_scene == nullptr, "Node ({}) is already in the tree.",
+        fmt::ptr(this)
     );
+    std::vector<Node*> subtree_nodes;
+    std::vector<Node*> pending_nodes{this};
+    while (not pending_nodes.empty()) {
+        Node* node = pending_nodes.back();
+        pending_nodes.pop_back();
+        node->_root_distance = node->_parent->_root_distance + 1;
+        node->_scene = scene;
+        subtree_nodes.push_back(node);
+        // reversed, so nodes are collected in pre-order
+        pending_nodes.insert(
+            pending_nodes.end(), node->_children.rbegin(),
+            node->_children.rend()
+        );
+    }
+
+    if (scene == nullptr) {
+        return;
+    }
+    scene->handle_add_nodes_to_tree(subtree_nodes);
+    for (Node* node : subtree_nodes) {
+        // callbacks may delete nodes which didn't enter the scene yet
+        if (not node->_marked_to_delete) {
+            node->_on_enter_scene();
+        }
+    }
 }
 
-glm::fmat4
-Node::_compute_model_matrix_cumulative(const Node* const ancestor) const
+void
+Node::_on_enter_scene()
 {
+    if (auto wrapper = this->wrapper_ptr()) {
+        wrapper->on_attach();
+    }
+
+    if (this->_type == NodeType::space) {
+        this->_scene->register_simulation(this);
+    } else if (this->_type == NodeType::body) {
+        this->body.attach_to_simulation();
+    } else if (this->_type == NodeType::hitbox) {
+        this->hitbox.attach_to_simulation();
+    }
+
+    this->set_dirty_flags(DIRTY_MODEL_MATRIX);
+}
+
+AffineTransformation<float>
+Node::_compute_model_matrix(
+    const AffineTransformation<float>& parent_matrix
+) const
+{
+    return parent_matrix * AffineTransformation<float>::from_components(
+                               glm::fvec2(this->_position),
+                               static_cast<float>(this->_rotation),
+                               glm::fvec2(this->_scale)
+                           );
+}
+
+AffineTransformation<double>
+Node::_compute_local_model_matrix() const
+{
+    return AffineTransformation<double>::from_components(
+        this->_position, this->_rotation, this->_scale
+    );
+}
+
+AffineTransformation<double>
+Node::_compute_relative_model_matrix(const Node* const ancestor) const
+{
+    // Cached model matrices are absolute and single precision, far from
+    // the origin they can't represent small relative offsets, so chain
+    // of local matrices is multiplied in double precision instead.
+    AffineTransformation<double> matrix = this->_compute_local_model_matrix();
     const Node* pointer = this;
-    std::vector<const Node*> inheritance_chain{pointer};
     while ((pointer = pointer->_parent) != ancestor) {
         if (pointer == nullptr) {
             throw kaacore::exception("Can't compute position relative to node "
                                      "that isn't its parent.");
         }
-        inheritance_chain.push_back(pointer);
-    }
-
-    glm::fmat4 matrix(1.0);
-    for (auto it = inheritance_chain.rbegin(); it != inheritance_chain.rend();
-         it++) {
-        matrix = (*it)->_compute_model_matrix(matrix);
+        matrix = pointer->_compute_local_model_matrix() * matrix;
     }
     return matrix;
 }
@@ -138,7 +271,7 @@ Node::_compute_model_matrix_cumulative(const Node* const ancestor) const
 void
 Node::_recalculate_model_matrix()
 {
-    const static glm::fmat4 identity(1.0);
+    const static AffineTransformation<float> identity;
     this->_model_matrix.value = this->_compute_model_matrix(
         this->_parent ? this->_parent->_model_matrix.value : identity
     );
@@ -148,12 +281,10 @@ Node::_recalculate_model_matrix()
 void
 Node::_recalculate_model_matrix_cumulative()
 {
-    Node* pointer = this;
-    std::vector<Node*> inheritance_chain{pointer};
-    while ((pointer = pointer->_parent) != nullptr and
-           pointer->query_dirty_flags(DIRTY_MODEL_MATRIX)) {
-        inheritance_chain.push_back(pointer);
-    }
+    const auto& inheritance_chain =
+        this->build_inheritance_chain([this](Node* n) {
+            return n == this or n->query_dirty_flags(DIRTY_MODEL_MATRIX);
+        });
 
     for (auto it = inheritance_chain.rbegin(); it != inheritance_chain.rend();
          it++) {
@@ -196,10 +327,12 @@ Node::_make_draw_bucket_key() const
     key.z_index = this->_ordering_data.calculated_z_index;
     key.root_distance = this->_root_distance;
     key.texture = this->_sprite.texture.get();
-    if (not this->_material and this->_type == NodeType::text) {
+    if (this->_cold_data and this->_cold_data->material) {
+        key.material = this->_cold_data->material.get();
+    } else if (this->_type == NodeType::text) {
         key.material = get_engine()->renderer->sdf_font_material.get();
     } else {
-        key.material = this->_material.get();
+        key.material = nullptr;
     }
     key.state_flags = 0u;
     key.stencil_flags = this->_stencil_data.calculated_flags;
@@ -215,45 +348,112 @@ Node::add_child(NodeOwnerPtr& owned_ptr)
 
     auto child_node = owned_ptr.release();
     child_node->_parent = this;
+    child_node->_index_in_parent = this->_children.size();
     this->_children.push_back(child_node.get());
+    if (this->_scene) {
+        this->_scene->_nodes_preorder_index.insert_subtree(child_node.get());
+    }
 
-    if (child_node->_node_wrapper) {
-        child_node->_node_wrapper->on_add_to_parent();
+    if (auto wrapper = child_node->wrapper_ptr()) {
+        wrapper->on_add_to_parent();
     }
 
-    // TODO set root
-    // TODO optimize (replace with iterator?)
-    std::function<void(Node*)> initialize_node;
-    initialize_node = [&initialize_node, this](Node* n) {
-        n->_root_distance = n->_parent->_root_distance + 1;
-        bool added_to_scene =
-            (n->_scene == nullptr and this->_scene != nullptr);
-        n->_scene = this->_scene;
-        if (added_to_scene) {
-            this->_scene->handle_add_node_to_tree(n);
+    child_node->_enter_tree();
+    return child_node;
+}
 
-            if (n->_node_wrapper) {
-                n->_node_wrapper->on_attach();
-            }
+std::vector<NodePtr>
+Node::spawn_children(
+    const NodeTemplate& node_template,
+    const std::vector<NodeSpawnTransformation>& transformations
+)
+{
+    std::vector<NodePtr> spawned_nodes;
+    spawned_nodes.reserve(transformations.size());
+    const size_t first_child_index = this->_children.size();
+    this->_children.reserve(first_child_index + transformations.size());
+    const ShapeHandle shape = intern_shape(node_template.shape);
+
+    for (const auto& transformation : transformations) {
+        NodeOwnerPtr owned_ptr{new Node(node_template.type)};
+        Node* node = owned_ptr.get();
+        node->shape(shape);
+        node->sprite(node_template.sprite);
+        node->z_index(node_template.z_index);
+        node->color(node_template.color);
+        node->visible(node_template.visible);
+        node->origin_alignment(node_template.origin_alignment);
+        node->lifetime(node_template.lifetime);
+        node->indexable(node_template.indexable);
+        node->position(transformation.position);
+        node->rotation(transformation.rotation);
+        node->scale(transformation.scale);
+
+        node->_parent = this;
+        node->_index_in_parent = this->_children.size();
+        node->_root_distance = this->_root_distance + 1;
+        this->_children.push_back(owned_ptr.release().get());
+        spawned_nodes.push_back(node);
+    }
 
-            if (n->_type == NodeType::space) {
-                n->_scene->register_simulation(n);
-            } else if (n->_type == NodeType::body) {
-                n->body.attach_to_simulation();
-            } else if (n->_type == NodeType::hitbox) {
-                n->hitbox.attach_to_simulation();
-            }
+    if (this->_scene == nullptr) {
+        return spawned_nodes;
+    }
 
-            n->set_dirty_flags(DIRTY_MODEL_MATRIX);
-        }
+    // spawned nodes have no children and no wrappers yet, so entering
+    // the tree can be done for all of them at once
+    this->_scene->_nodes_preorder_index.insert_children(
+        this, first_child_index
+    );
+    std::vector<Node*> entering_nodes{
+        this->_children.begin() + first_child_index, this->_children.end()
+    };
+    for (Node* node : entering_nodes) {
+        node->_scene = this->_scene;
+    }
+    this->_scene->handle_add_nodes_to_tree(entering_nodes);
+    for (Node* node : entering_nodes) {
+        node->_on_enter_scene();
+    }
+    return spawned_nodes;
+}
 
-        std::for_each(
-            n->_children.begin(), n->_children.end(), initialize_node
+void
+Node::prepare_subtree()
+{
+    KAACORE_CHECK(
+        this->_parent == nullptr and this->_scene == nullptr,
+        "Only root of a detached subtree can be prepared."
+    );
+    std::vector<Node*> pending_nodes{this};
+    while (not pending_nodes.empty()) {
+        Node* node = pending_nodes.back();
+        pending_nodes.pop_back();
+        if (node->_type == NodeType::tilemap) {
+            // creates chunk nodes, so it's done before visiting children
+            node->tilemap.rebuild_dirty_chunks();
+        } else if (node->_type == NodeType::hitbox and node->hitbox._cp_shape) {
+            node->hitbox.prepare_physics_shape();
+        }
+        pending_nodes.insert(
+            pending_nodes.end(), node->_children.begin(),
+            node->_children.end()
         );
-    };
+    }
+}
 
-    initialize_node(child_node.get());
-    return child_node;
+void
+Node::destroy_children()
+{
+    if (this->_scene == nullptr) {
+        this->_delete_children();
+        return;
+    }
+
+    // nodes in the tree are deleted in bulk at the end of the frame
+    for (Node* child : this->_children) {
+        child->_mark_to_delete();
+    }
 }
 
 void
@@ -268,16 +468,23 @@ Node::recalculate_model_matrix()
 VerticesIndicesVectorPair
 Node::recalculate_vertices_indices_data()
 {
+    if (this->_type == NodeType::particle_emitter) {
+        return this->particle_emitter.make_vertices_indices(
+            this->_model_matrix.value, this->_color
+        );
+    }
+
     KAACORE_ASSERT(
-        this->_shape,
+        *this->_shape,
         "Node has no shape set to calcualte vertices and indices data"
     );
 
+    const auto& shape_vertices = this->_shape->get_vertices();
     std::vector<StandardVertexData> computed_vertices;
-    computed_vertices.resize(this->_shape.vertices.size());
+    computed_vertices.resize(shape_vertices.size());
 
     glm::dvec2 pos_realignment = calculate_realignment_vector(
-        this->_origin_alignment, this->_shape.vertices_bbox
+        this->_origin_alignment, this->_shape->vertices_bbox
     );
 
     std::optional<std::pair<glm::dvec2, glm::dvec2>> uv_rect;
@@ -285,26 +492,25 @@ Node::recalculate_vertices_indices_data()
         uv_rect = this->_sprite.get_display_rect();
     }
 
-    std::transform(
-        this->_shape.vertices.cbegin(), this->_shape.vertices.cend(),
-        computed_vertices.begin(),
-        [this, &uv_rect, pos_realignment](const StandardVertexData& orig_vt
-        ) -> StandardVertexData {
-            StandardVertexData vt;
-            vt.xyz = this->_model_matrix.value *
-                     (glm::fvec4{orig_vt.xyz, 1.} +
-                      glm::fvec4{pos_realignment, 0., 0.});
-
-            if (uv_rect) {
-                vt.uv = glm::mix(uv_rect->first, uv_rect->second, orig_vt.uv);
-            }
-            vt.mn = orig_vt.mn;
-            vt.rgba *= this->_color;
-            return vt;
-        }
+    // realignment is folded into translation, so the whole
+    // array is processed in a single pass
+    const auto& model_matrix = this->_model_matrix.value;
+    VertexTransformParams params;
+    params.x_axis = model_matrix.x_axis;
+    params.y_axis = model_matrix.y_axis;
+    params.translation =
+        model_matrix.apply_vector(glm::fvec2(pos_realignment)) +
+        model_matrix.translation;
+    if (uv_rect) {
+        params.uv_origin = uv_rect->first;
+        params.uv_span = uv_rect->second - uv_rect->first;
+    }
+    params.color = this->_color;
+    transform_vertices(
+        shape_vertices.data(), computed_vertices.data(),
+        computed_vertices.size(), params
     );
-
-    return {computed_vertices, this->_shape.indices};
+    return {computed_vertices, this->_shape->get_indices()};
 }
 
 void
@@ -314,8 +520,9 @@ Node::recalculate_ordering_data()
         return;
     }
 
-    if (this->_render_passes.has_value()) {
-        this->_ordering_data.calculated_render_passes = *this->_render_passes;
+    if (this->_cold_data and this->_cold_data->render_passes) {
+        this->_ordering_data.calculated_render_passes =
+            *this->_cold_data->render_passes;
     } else if (this->is_root()) {
         this->_ordering_data.calculated_render_passes =
             default_root_render_passes;
@@ -329,8 +536,9 @@ Node::recalculate_ordering_data()
             this->_parent->_ordering_data.calculated_render_passes;
     }
 
-    if (this->_viewports.has_value()) {
-        this->_ordering_data.calculated_viewports = *this->_viewports;
+    if (this->_cold_data and this->_cold_data->viewports) {
+        this->_ordering_data.calculated_viewports =
+            *this->_cold_data->viewports;
     } else if (this->is_root()) {
         this->_ordering_data.calculated_viewports = default_root_viewports;
     } else {
@@ -444,7 +652,7 @@ Node::calculate_draw_unit_removal() const
 }
 
 DrawUnitModificationPack
-Node::calculate_draw_unit_updates()
+Node::calculate_draw_unit_updates(const bool defer_vertices)
 {
     KAACORE_ASSERT(
         this->_scene_tree_id != 0u, "Node ({}) has no scene tree id",
@@ -460,8 +668,13 @@ Node::calculate_draw_unit_updates()
     this->recalculate_visibility_data();
     this->recalculate_stencil_data();
 
+    // particle emitters ignore node's shape, particles are drawn instead
+    const bool has_geometry =
+        this->_type == NodeType::particle_emitter
+            ? this->particle_emitter.particles_count() > 0
+            : bool(*this->_shape);
     const bool is_visible =
-        this->_shape and this->_visibility_data.calculated_visible;
+        has_geometry and this->_visibility_data.calculated_visible;
     const std::optional<DrawBucketKey> calculated_draw_bucket_key =
         is_visible ? std::optional<DrawBucketKey>{this->_make_draw_bucket_key()}
                    : std::nullopt;
@@ -487,16 +700,23 @@ Node::calculate_draw_unit_updates()
         };
 
         upsert_mod->updated_vertices_indices = true;
-        auto vertices_indices_pair = this->recalculate_vertices_indices_data();
-        upsert_mod->state_update.vertices =
-            std::move(vertices_indices_pair.first);
-        upsert_mod->state_update.indices =
-            std::move(vertices_indices_pair.second);
+        if (not defer_vertices) {
+            this->calculate_draw_unit_vertices(*upsert_mod);
+        }
     }
 
     return {upsert_mod, remove_mod};
 }
 
+void
+Node::calculate_draw_unit_vertices(DrawUnitModification& upsert_mod)
+{
+    // only reads node's state, model matrix must be already recalculated
+    auto vertices_indices_pair = this->recalculate_vertices_indices_data();
+    upsert_mod.state_update.vertices = std::move(vertices_indices_pair.first);
+    upsert_mod.state_update.indices = std::move(vertices_indices_pair.second);
+}
+
 void
 Node::clear_draw_unit_updates(const std::optional<const DrawBucketKey> key)
 {
@@ -531,6 +751,42 @@ Node::set_dirty_flags(const Node::DirtyFlagsType flags)
     }
 }
 
+void
+Node::set_dirty_flags(
+    const std::vector<Node*>& nodes, const Node::DirtyFlagsType flags
+)
+{
+    // Flags are set on all of the nodes before propagating them,
+    // so propagation stops at descendants which are part of the batch,
+    // those will propagate unapplied flags to their own subtrees.
+    thread_local std::vector<DirtyFlagsType> unapplied_recursive_flags;
+    unapplied_recursive_flags.clear();
+    unapplied_recursive_flags.reserve(nodes.size());
+    for (Node* node : nodes) {
+        unapplied_recursive_flags.push_back(
+            flags & ~node->_dirty_flags & DIRTY_ANY_RECURSIVE
+        );
+        node->_dirty_flags |= flags;
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const auto unapplied_flags = unapplied_recursive_flags[i];
+        if (unapplied_flags.none() or nodes[i]->_children.empty()) {
+            continue;
+        }
+        auto children_flags =
+            unapplied_flags | unapplied_flags >> DIRTY_FLAGS_SHIFT_RECURSIVE;
+        auto propagate_flags = [children_flags](Node* node) {
+            bool descend =
+                (children_flags & ~node->_dirty_flags & DIRTY_ANY_RECURSIVE)
+                    .any();
+            node->_dirty_flags |= children_flags;
+            return descend;
+        };
+        nodes[i]->recursive_call_downstream_children(propagate_flags);
+    }
+}
+
 void
 Node::clear_dirty_flags(const Node::DirtyFlagsType flags)
 {
@@ -561,6 +817,15 @@ Node::children()
     return result;
 }
 
+NodesPreorderIndex*
+Node::_valid_preorder_index() const
+{
+    if (this->_scene and this->_scene->_nodes_preorder_index.is_valid) {
+        return &this->_scene->_nodes_preorder_index;
+    }
+    return nullptr;
+}
+
 bool
 Node::is_root() const
 {
@@ -591,9 +856,7 @@ Node::absolute_position()
         this->_recalculate_model_matrix_cumulative();
     }
 
-    glm::fvec4 pos = {0., 0., 0., 1.};
-    pos = this->_model_matrix.value * pos;
-    return {pos.x, pos.y};
+    return this->_model_matrix.value.translation;
 }
 
 glm::dvec2
@@ -607,9 +870,67 @@ Node::get_relative_position(const Node* const ancestor)
         return {0., 0.};
     }
 
-    glm::fvec4 pos = {0., 0., 0., 1.};
-    pos = this->_compute_model_matrix_cumulative(ancestor) * pos;
-    return {pos.x, pos.y};
+    return this->_compute_relative_model_matrix(ancestor).translation;
+}
+
+std::vector<glm::dvec2>
+Node::get_relative_positions(
+    const std::vector<Node*>& nodes, Node* const ancestor
+)
+{
+    std::vector<glm::dvec2> positions;
+    positions.reserve(nodes.size());
+    if (ancestor == nullptr) {
+        for (Node* node : nodes) {
+            positions.push_back(node->absolute_position());
+        }
+        return positions;
+    }
+
+    // Relative matrices along the path of the previous node are kept,
+    // indexed by distance from the ancestor, so shared parts of the
+    // paths (e.g. siblings' parent) are multiplied only once.
+    thread_local std::vector<const Node*> path;
+    thread_local std::vector<
+        std::pair<const Node*, AffineTransformation<double>>>
+        previous_path;
+    previous_path.clear();
+    for (Node* node : nodes) {
+        path.clear();
+        for (const Node* pointer = node; pointer != ancestor;
+             pointer = pointer->_parent) {
+            if (pointer == nullptr) {
+                throw kaacore::exception(
+                    "Can't compute position relative to node "
+                    "that isn't its parent."
+                );
+            }
+            path.push_back(pointer);
+        }
+
+        size_t shared_length = 0;
+        while (shared_length < path.size() and
+               shared_length < previous_path.size() and
+               previous_path[shared_length].first ==
+                   path[path.size() - shared_length - 1]) {
+            shared_length++;
+        }
+        previous_path.erase(
+            previous_path.begin() + shared_length, previous_path.end()
+        );
+
+        AffineTransformation<double> matrix;
+        if (not previous_path.empty()) {
+            matrix = previous_path.back().second;
+        }
+        for (size_t i = shared_length; i < path.size(); i++) {
+            const Node* path_node = path[path.size() - i - 1];
+            matrix = matrix * path_node->_compute_local_model_matrix();
+            previous_path.emplace_back(path_node, matrix);
+        }
+        positions.push_back(matrix.translation);
+    }
+    return positions;
 }
 
 double
@@ -679,19 +1000,23 @@ Node::absolute_transformation()
     if (this->query_dirty_flags(DIRTY_MODEL_MATRIX)) {
         this->_recalculate_model_matrix_cumulative();
     }
-    return Transformation{this->_model_matrix.value};
+    return Transformation{
+        AffineTransformation<double>{this->_model_matrix.value}
+    };
 }
 
 Transformation
 Node::get_relative_transformation(const Node* const ancestor)
 {
-    if (ancestor == nullptr) {
-        return Transformation{this->_compute_model_matrix(glm::dmat4(1.0))};
+    if (ancestor == nullptr or ancestor == this->_parent) {
+        return Transformation{AffineTransformation<double>{
+            this->_compute_model_matrix(AffineTransformation<float>{})
+        }};
     } else if (ancestor == this) {
-        return Transformation{glm::dmat4(1.)};
+        return Transformation{};
     }
 
-    return Transformation{this->_compute_model_matrix_cumulative(ancestor)};
+    return Transformation{this->_compute_relative_model_matrix(ancestor)};
 }
 
 Transformation
@@ -734,6 +1059,12 @@ Node::effective_z_index()
 
 Shape
 Node::shape()
+{
+    return *this->_shape;
+}
+
+const ShapeHandle&
+Node::shape_handle() const
 {
     return this->_shape;
 }
@@ -747,11 +1078,18 @@ Node::shape(const Shape& shape)
 void
 Node::shape(const Shape& shape, bool is_auto_shape)
 {
+    this->shape(intern_shape(shape), is_auto_shape);
+}
+
+void
+Node::shape(const ShapeHandle& shape, bool is_auto_shape)
+{
+    KAACORE_CHECK(shape != nullptr, "Invalid shape handle.");
     if (this->_shape == shape) {
         return;
     }
     this->_shape = shape;
-    if (not shape) {
+    if (not *shape) {
         this->_auto_shape = true;
     } else {
         this->_auto_shape = is_auto_shape;
@@ -763,6 +1101,16 @@ Node::shape(const Shape& shape, bool is_auto_shape)
     this->set_dirty_flags(DIRTY_DRAW_VERTICES | DIRTY_SPATIAL_INDEX);
 }
 
+void
+Node::geometry_changed()
+{
+    KAACORE_CHECK(
+        this->_shape->geometry != nullptr,
+        "Node's shape does not use geometry buffer."
+    );
+    this->set_dirty_flags(DIRTY_DRAW_VERTICES);
+}
+
 Sprite
 Node::sprite()
 {
@@ -790,16 +1138,23 @@ Node::sprite(const Sprite& sprite)
     }
 }
 
-ResourceReference<Material>&
+const ResourceReference<Material>&
 Node::material()
 {
-    return this->_material;
+    if (not this->_cold_data) {
+        static const ResourceReference<Material> default_material;
+        return default_material;
+    }
+    return this->_cold_data->material;
 }
 
 void
 Node::material(const ResourceReference<Material>& material)
 {
-    this->_material = material;
+    if (not this->_cold_data and not material) {
+        return;
+    }
+    this->_cold().material = material;
 }
 
 glm::dvec4
@@ -855,18 +1210,29 @@ Node::origin_alignment(const Alignment alignment)
 NodeTransitionHandle
 Node::transition()
 {
-    return this->_transitions_manager.get(default_transition_name);
+    if (not this->_cold_data) {
+        return nullptr;
+    }
+    return this->_cold_data->transitions_manager.get(default_transition_name);
 }
 
 void
 Node::transition(const NodeTransitionHandle& transition)
 {
-    this->_transitions_manager.set(default_transition_name, transition);
+    if (not this->_cold_data and not transition) {
+        return;
+    }
+    this->_cold().transitions_manager.set(
+        default_transition_name, transition
+    );
 }
 
 Duration
 Node::lifetime()
 {
+    if (this->_lifetime_queue_position != NodesLifetimeQueue::unscheduled) {
+        return this->_scene->_nodes_lifetime_queue.remaining(this);
+    }
     return this->_lifetime;
 }
 
@@ -875,12 +1241,74 @@ Node::lifetime(const Duration lifetime)
 {
     this->_lifetime =
         std::chrono::duration_cast<HighPrecisionDuration>(lifetime);
+    if (this->_scene == nullptr or this->_marked_to_delete) {
+        // lifetime will be scheduled when node enters the tree
+        return;
+    }
+    if (this->_offscreen_pause == OffscreenUpdatePolicy::pause_all) {
+        // lifetime will be scheduled when node becomes visible
+        return;
+    }
+
+    auto& lifetime_queue = this->_scene->_nodes_lifetime_queue;
+    if (this->_lifetime > 0us) {
+        lifetime_queue.schedule(this, this->_lifetime);
+    } else {
+        lifetime_queue.unschedule(this);
+    }
+}
+
+OffscreenUpdatePolicy
+Node::offscreen_update_policy() const
+{
+    return this->_offscreen_update_policy;
+}
+
+void
+Node::offscreen_update_policy(const OffscreenUpdatePolicy policy)
+{
+    this->_offscreen_update_policy = policy;
+    // make sure visibility check won't use stale bounding boxes
+    this->set_dirty_flags(DIRTY_SPATIAL_INDEX_RECURSIVE);
+}
+
+bool
+Node::is_offscreen_paused() const
+{
+    return this->_offscreen_pause != OffscreenUpdatePolicy::always;
+}
+
+void
+Node::_set_offscreen_pause(const OffscreenUpdatePolicy pause)
+{
+    if (pause == this->_offscreen_pause) {
+        return;
+    }
+
+    const bool lifetime_paused =
+        this->_offscreen_pause == OffscreenUpdatePolicy::pause_all;
+    this->_offscreen_pause = pause;
+    if (this->_scene == nullptr or
+        lifetime_paused == (pause == OffscreenUpdatePolicy::pause_all)) {
+        return;
+    }
+
+    auto& lifetime_queue = this->_scene->_nodes_lifetime_queue;
+    if (not lifetime_paused) {
+        if (this->_lifetime_queue_position !=
+            NodesLifetimeQueue::unscheduled) {
+            this->_lifetime = lifetime_queue.remaining(this);
+            lifetime_queue.unschedule(this);
+        }
+    } else if (this->_lifetime > 0us) {
+        lifetime_queue.schedule(this, this->_lifetime);
+    }
 }
 
 NodeTransitionsManager&
 Node::transitions_manager()
 {
-    return this->_transitions_manager;
+    return this->_cold().transitions_manager;
 }
 
 Scene* const
@@ -903,16 +1331,21 @@ Node::render_passes(const std::optional<std::unordered_set<int16_t>>& indices)
             indices->size() <= KAACORE_MAX_RENDER_PASSES,
             "Invalid indices size."
         );
+    } else if (not this->_cold_data) {
+        return;
     }
 
     this->set_dirty_flags(DIRTY_DRAW_KEYS_RECURSIVE | DIRTY_ORDERING_RECURSIVE);
-    this->_render_passes = indices;
+    this->_cold().render_passes = indices;
 }
 
 const std::optional<std::vector<int16_t>>
 Node::render_passes() const
 {
-    return this->_render_passes;
+    if (not this->_cold_data) {
+        return std::nullopt;
+    }
+    return this->_cold_data->render_passes;
 }
 
 const std::vector<int16_t>
@@ -929,16 +1362,21 @@ Node::viewports(const std::optional<std::unordered_set<int16_t>>& z_indices)
         KAACORE_CHECK(
             z_indices->size() <= KAACORE_MAX_VIEWPORTS, "Invalid indices size."
         );
+    } else if (not this->_cold_data) {
+        return;
     }
 
     this->set_dirty_flags(DIRTY_DRAW_KEYS_RECURSIVE | DIRTY_ORDERING_RECURSIVE);
-    this->_viewports = z_indices;
+    this->_cold().viewports = z_indices;
 }
 
 const std::optional<std::vector<int16_t>>
 Node::viewports() const
 {
-    return this->_viewports;
+    if (not this->_cold_data) {
+        return std::nullopt;
+    }
+    return this->_cold_data->viewports;
 }
 
 const std::vector<int16_t>
@@ -974,14 +1412,19 @@ Node::stencil_mode(const std::optional<StencilMode> stencil_mode)
 void
 Node::setup_wrapper(std::unique_ptr<ForeignNodeWrapper>&& wrapper)
 {
-    KAACORE_ASSERT(!this->_node_wrapper, "Node wrapper already initialized.");
-    this->_node_wrapper = std::move(wrapper);
+    KAACORE_ASSERT(
+        this->wrapper_ptr() == nullptr, "Node wrapper already initialized."
+    );
+    this->_cold().node_wrapper = std::move(wrapper);
 }
 
 ForeignNodeWrapper*
 Node::wrapper_ptr() const
 {
-    return this->_node_wrapper.get();
+    if (not this->_cold_data) {
+        return nullptr;
+    }
+    return this->_cold_data->node_wrapper.get();
 }
 
 void
@@ -1000,6 +1443,66 @@ Node::indexable() const
     return this->_indexable;
 }
 
+void
+Node::add_tag(const std::string& tag)
+{
+    KAACORE_CHECK(not tag.empty(), "Tag must not be empty.");
+    if (this->has_tag(tag)) {
+        return;
+    }
+    this->_cold().tags.push_back({tag});
+    if (this->_scene and not this->_marked_to_delete) {
+        this->_scene->_nodes_groups_index.add(this, tag);
+    }
+}
+
+void
+Node::remove_tag(const std::string& tag)
+{
+    auto node_tag = this->_find_tag(tag);
+    if (node_tag == nullptr) {
+        return;
+    }
+    if (node_tag->group_position != NodesGroupsIndex::unindexed) {
+        this->_scene->_nodes_groups_index.remove(this, tag);
+    }
+    auto& tags = this->_cold_data->tags;
+    tags.erase(tags.begin() + (node_tag - tags.data()));
+}
+
+bool
+Node::has_tag(const std::string& tag) const
+{
+    return this->_find_tag(tag) != nullptr;
+}
+
+std::vector<std::string>
+Node::tags() const
+{
+    std::vector<std::string> result;
+    if (this->_cold_data) {
+        result.reserve(this->_cold_data->tags.size());
+        for (const auto& node_tag : this->_cold_data->tags) {
+            result.push_back(node_tag.name);
+        }
+    }
+    return result;
+}
+
+NodeTag*
+Node::_find_tag(const std::string& tag) const
+{
+    if (not this->_cold_data) {
+        return nullptr;
+    }
+    for (auto& node_tag : this->_cold_data->tags) {
+        if (node_tag.name == tag) {
+            return &node_tag;
+        }
+    }
+    return nullptr;
+}
+
 uint16_t
 Node::root_distance() const
 {
@@ -1012,20 +1515,34 @@ Node::scene_tree_id() const
     return this->_scene_tree_id;
 }
 
+NodeHandle
+Node::handle()
+{
+    KAACORE_CHECK(
+        this->_scene != nullptr, "Node ({}) is not attached to the tree.",
+        fmt::ptr(this)
+    );
+    KAACORE_CHECK(
+        not this->_marked_to_delete, "Node ({}) is marked for deletion.",
+        fmt::ptr(this)
+    );
+    return this->_scene->_nodes_handles_registry.acquire(this);
+}
+
 BoundingBox<double>
 Node::bounding_box()
 {
     const auto transformation = this->absolute_transformation();
-    if (this->_shape) {
+    if (*this->_shape) {
         KAACORE_ASSERT(
-            not this->_shape.bounding_points.empty(),
+            not this->_shape->bounding_points.empty(),
             "Shape must have bounding points"
         );
         std::vector<glm::dvec2> bounding_points;
-        bounding_points.resize(this->_shape.bounding_points.size());
+        bounding_points.resize(this->_shape->bounding_points.size());
         std::transform(
-            this->_shape.bounding_points.begin(),
-            this->_shape.bounding_points.end(), bounding_points.begin(),
+            this->_shape->bounding_points.begin(),
+            this->_shape->bounding_points.end(), bounding_points.begin(),
             [&transformation](glm::dvec2 pt) -> glm::dvec2 {
                 return pt | transformation;
             }
@@ -1049,4 +1566,449 @@ Node::_update_hitboxes()
     });
 }
 
+void
+NodesPreorderIndex::rebuild(Node* const root)
+{
+    KAACORE_ASSERT(
+        this->active_walks == 0,
+        "Can't rebuild preorder index while it's being walked."
+    );
+    KAACORE_LOG_TRACE("Rebuilding nodes preorder index");
+    this->nodes.clear();
+    this->_append_subtree(root);
+    this->is_valid = true;
+}
+
+void
+NodesPreorderIndex::invalidate()
+{
+    if (this->is_valid) {
+        KAACORE_LOG_TRACE("Invalidating nodes preorder index");
+        this->is_valid = false;
+    }
+}
+
+void
+NodesPreorderIndex::insert_subtree(Node* const subtree_root)
+{
+    KAACORE_ASSERT(
+        subtree_root->_parent != nullptr and
+            subtree_root->_index_in_parent + 1 ==
+                subtree_root->_parent->_children.size(),
+        "Inserted subtree must be the last child of its parent."
+    );
+    this->insert_children(
+        subtree_root->_parent, subtree_root->_index_in_parent
+    );
+}
+
+void
+NodesPreorderIndex::insert_children(
+    Node* const parent, const size_t first_child_index
+)
+{
+    if (not this->is_valid) {
+        return;
+    }
+
+    KAACORE_ASSERT(
+        parent->_preorder_position < this->nodes.size() and
+            this->nodes[parent->_preorder_position] == parent,
+        "Parent node is not tracked by the preorder index."
+    );
+    const size_t insert_position =
+        parent->_preorder_position + parent->_subtree_size;
+    if (this->active_walks > 0 or
+        this->nodes.size() - insert_position > max_insertion_shift) {
+        this->invalidate();
+        return;
+    }
+
+    // new subtrees always land at the end of parent's range,
+    // matching their positions among parent's children
+    thread_local std::vector<Node*> subtree_nodes;
+    subtree_nodes.clear();
+    std::swap(subtree_nodes, this->nodes);
+    for (size_t i = first_child_index; i < parent->_children.size(); i++) {
+        this->_append_subtree(parent->_children[i]);
+    }
+    std::swap(subtree_nodes, this->nodes);
+
+    this->nodes.insert(
+        this->nodes.begin() + insert_position, subtree_nodes.begin(),
+        subtree_nodes.end()
+    );
+    for (size_t i = insert_position; i < this->nodes.size(); i++) {
+        this->nodes[i]->_preorder_position = i;
+    }
+    for (Node* ancestor = parent; ancestor != nullptr;
+         ancestor = ancestor->_parent) {
+        ancestor->_subtree_size += subtree_nodes.size();
+    }
+}
+
+void
+NodesPreorderIndex::remove_marked(const std::vector<Node*>& marked_nodes)
+{
+    if (not this->is_valid or marked_nodes.empty()) {
+        return;
+    }
+    if (this->active_walks > 0) {
+        this->invalidate();
+        return;
+    }
+
+    // only roots of removed subtrees are relevant, their ranges
+    // cover everything that will be deleted with them
+    const auto is_removal_root = [](const Node* node) {
+        return node->_marked_to_delete and node->_parent != nullptr and
+               not node->_parent->_marked_to_delete;
+    };
+
+    size_t first_position = this->nodes.size();
+    for (Node* node : marked_nodes) {
+        if (not node->_is_marked_subtree_root()) {
+            continue;
+        }
+        first_position =
+            std::min<size_t>(first_position, node->_preorder_position);
+        for (Node* ancestor = node->_parent; ancestor != nullptr;
+             ancestor = ancestor->_parent) {
+            ancestor->_subtree_size -= node->_subtree_size;
+        }
+    }
+
+    size_t write_position = first_position;
+    size_t read_position = first_position;
+    while (read_position < this->nodes.size()) {
+        Node* node = this->nodes[read_position];
+        if (is_removal_root(node)) {
+            read_position += node->_subtree_size;
+            continue;
+        }
+        node->_preorder_position = write_position;
+        this->nodes[write_position++] = node;
+        read_position++;
+    }
+    this->nodes.resize(write_position);
+}
+
+void
+NodesPreorderIndex::_append_subtree(Node* const subtree_root)
+{
+    const size_t first_position = this->nodes.size();
+    thread_local std::vector<Node*> nodes_stack;
+    nodes_stack.clear();
+    nodes_stack.push_back(subtree_root);
+    while (not nodes_stack.empty()) {
+        Node* node = nodes_stack.back();
+        nodes_stack.pop_back();
+        node->_preorder_position = this->nodes.size();
+        this->nodes.push_back(node);
+        // reversed, so children are popped in their original order
+        nodes_stack.insert(
+            nodes_stack.end(), node->_children.rbegin(),
+            node->_children.rend()
+        );
+    }
+
+    // children are placed after their parents, so iterating
+    // backwards guarantees that their sizes are already known
+    for (size_t i = this->nodes.size(); i-- > first_position;) {
+        Node* node = this->nodes[i];
+        node->_subtree_size = 1;
+        for (const Node* child : node->_children) {
+            node->_subtree_size += child->_subtree_size;
+        }
+    }
+}
+
+void
+NodesGroupsIndex::add(Node* const node)
+{
+    if (not node->_cold_data) {
+        return;
+    }
+    for (auto& node_tag : node->_cold_data->tags) {
+        this->add(node, node_tag.name);
+    }
+}
+
+void
+NodesGroupsIndex::add(Node* const node, const std::string& tag)
+{
+    auto node_tag = node->_find_tag(tag);
+    KAACORE_ASSERT(node_tag != nullptr, "Node has no tag: {}.", tag);
+    KAACORE_ASSERT(
+        node_tag->group_position == unindexed,
+        "Node ({}) is already indexed in group: {}.", fmt::ptr(node), tag
+    );
+    auto& group = this->_groups[tag];
+    node_tag->group_position = group.size();
+    group.push_back(node);
+}
+
+void
+NodesGroupsIndex::remove(Node* const node)
+{
+    if (not node->_cold_data) {
+        return;
+    }
+    for (auto& node_tag : node->_cold_data->tags) {
+        if (node_tag.group_position != unindexed) {
+            this->remove(node, node_tag.name);
+        }
+    }
+}
+
+void
+NodesGroupsIndex::remove(Node* const node, const std::string& tag)
+{
+    auto node_tag = node->_find_tag(tag);
+    KAACORE_ASSERT(
+        node_tag != nullptr and node_tag->group_position != unindexed,
+        "Node ({}) is not indexed in group: {}.", fmt::ptr(node), tag
+    );
+    auto group_it = this->_groups.find(tag);
+    KAACORE_ASSERT(group_it != this->_groups.end(), "Missing group: {}.", tag);
+    auto& group = group_it->second;
+    const uint32_t position = node_tag->group_position;
+    Node* last_node = group.back();
+    group[position] = last_node;
+    last_node->_find_tag(tag)->group_position = position;
+    group.pop_back();
+    node_tag->group_position = unindexed;
+    if (group.empty()) {
+        this->_groups.erase(group_it);
+    }
+}
+
+void
+NodesGroupsIndex::clear()
+{
+    for (auto& [tag, group] : this->_groups) {
+        for (Node* node : group) {
+            node->_find_tag(tag)->group_position = unindexed;
+        }
+    }
+    this->_groups.clear();
+}
+
+const std::vector<Node*>&
+NodesGroupsIndex::group(const std::string& tag) const
+{
+    static const std::vector<Node*> empty_group;
+    auto group_it = this->_groups.find(tag);
+    if (group_it == this->_groups.end()) {
+        return empty_group;
+    }
+    return group_it->second;
+}
+
+size_t
+NodesGroupsIndex::group_size(const std::string& tag) const
+{
+    return this->group(tag).size();
+}
+
+NodeHandle
+NodesHandlesRegistry::acquire(Node* const node)
+{
+    if (node->_handle_slot == unassigned) {
+        if (this->_free_slots.empty()) {
+            node->_handle_slot = this->_slots.size();
+            this->_slots.emplace_back();
+        } else {
+            node->_handle_slot = this->_free_slots.back();
+            this->_free_slots.pop_back();
+        }
+        this->_slots[node->_handle_slot].node = node;
+    }
+    return {node->_handle_slot, this->_slots[node->_handle_slot].generation};
+}
+
+void
+NodesHandlesRegistry::release(Node* const node)
+{
+    if (node->_handle_slot == unassigned) {
+        return;
+    }
+    auto& slot = this->_slots[node->_handle_slot];
+    KAACORE_ASSERT(slot.node == node, "Handle slot assigned to other node.");
+    slot.node = nullptr;
+    // generation 0 is reserved for empty handles
+    if (++slot.generation == 0) {
+        slot.generation = 1;
+    }
+    this->_free_slots.push_back(node->_handle_slot);
+    node->_handle_slot = unassigned;
+}
+
+Node*
+NodesHandlesRegistry::resolve(const NodeHandle& handle) const
+{
+    if (handle.slot >= this->_slots.size()) {
+        return nullptr;
+    }
+    const auto& slot = this->_slots[handle.slot];
+    if (slot.generation != handle.generation) {
+        return nullptr;
+    }
+    return slot.node;
+}
+
+void
+NodesHandlesRegistry::clear()
+{
+    for (auto& slot : this->_slots) {
+        if (slot.node) {
+            slot.node->_handle_slot = unassigned;
+        }
+    }
+    this->_slots.clear();
+    this->_free_slots.clear();
+}
+
+size_t
+NodesHandlesRegistry::size() const
+{
+    return this->_slots.size() - this->_free_slots.size();
+}
+
+void
+NodesLifetimeQueue::schedule(
+    Node* const node, const HighPrecisionDuration lifetime
+)
+{
+    KAACORE_ASSERT(lifetime > 0us, "Lifetime must be greater than zero.");
+    node->_lifetime_expiration = this->_clock + lifetime;
+    if (node->_lifetime_queue_position == unscheduled) {
+        this->_heap.push_back(node);
+        node->_lifetime_queue_position = this->_heap.size() - 1;
+        this->_sift_up(node->_lifetime_queue_position);
+    } else {
+        // expiration might have moved in both directions
+        this->_sift_up(node->_lifetime_queue_position);
+        this->_sift_down(node->_lifetime_queue_position);
+    }
+}
+
+void
+NodesLifetimeQueue::unschedule(Node* const node)
+{
+    const uint32_t position = node->_lifetime_queue_position;
+    if (position == unscheduled) {
+        return;
+    }
+    KAACORE_ASSERT(
+        position < this->_heap.size() and this->_heap[position] == node,
+        "Invalid lifetime queue position of node: {}", fmt::ptr(node)
+    );
+    node->_lifetime_queue_position = unscheduled;
+
+    Node* last_node = this->_heap.back();
+    this->_heap.pop_back();
+    if (last_node != node) {
+        this->_place(last_node, position);
+        this->_sift_up(position);
+        this->_sift_down(last_node->_lifetime_queue_position);
+    }
+}
+
+void
+NodesLifetimeQueue::clear()
+{
+    for (Node* node : this->_heap) {
+        node->_lifetime_queue_position = unscheduled;
+    }
+    this->_heap.clear();
+}
+
+HighPrecisionDuration
+NodesLifetimeQueue::remaining(const Node* const node) const
+{
+    KAACORE_ASSERT(
+        node->_lifetime_queue_position != unscheduled,
+        "Node has no lifetime scheduled."
+    );
+    return std::max(node->_lifetime_expiration - this->_clock, 0us);
+}
+
+void
+NodesLifetimeQueue::advance(const HighPrecisionDuration dt)
+{
+    this->_clock += dt;
+}
+
+Node*
+NodesLifetimeQueue::pop_expired()
+{
+    if (this->_heap.empty() or
+        this->_heap.front()->_lifetime_expiration > this->_clock) {
+        return nullptr;
+    }
+    Node* node = this->_heap.front();
+    this->unschedule(node);
+    return node;
+}
+
+size_t
+NodesLifetimeQueue::size() const
+{
+    return this->_heap.size();
+}
+
+bool
+NodesLifetimeQueue::_is_before(const uint32_t lhs, const uint32_t rhs) const
+{
+    return this->_heap[lhs]->_lifetime_expiration <
+           this->_heap[rhs]->_lifetime_expiration;
+}
+
+void
+NodesLifetimeQueue::_place(Node* const node, const uint32_t position)
+{
+    this->_heap[position] = node;
+    node->_lifetime_queue_position = position;
+}
+
+void
+NodesLifetimeQueue::_sift_up(uint32_t position)
+{
+    while (position > 0) {
+        const uint32_t parent = (position - 1) / 2;
+        if (not this->_is_before(position, parent)) {
+            break;
+        }
+        Node* node = this->_heap[position];
+        this->_place(this->_heap[parent], position);
+        this->_place(node, parent);
+        position = parent;
+    }
+}
+
+void
+NodesLifetimeQueue::_sift_down(uint32_t position)
+{
+    const uint32_t size = this->_heap.size();
+    while (true) {
+        uint32_t smallest = position;
+        const uint32_t left = 2 * position + 1;
+        const uint32_t right = left + 1;
+        if (left < size and this->_is_before(left, smallest)) {
+            smallest = left;
+        }
+        if (right < size and this->_is_before(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == position) {
+            break;
+        }
+        Node* node = this->_heap[position];
+        this->_place(this->_heap[smallest], position);
+        this->_place(node, smallest);
+        position = smallest;
+    }
+}
+
 } // namespace kaacore
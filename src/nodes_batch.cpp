@@ -0,0 +1,266 @@
+#include "kaacore/exceptions.h"
+#include "kaacore/nodes.h"
+#include "kaacore/scenes.h"
+
+#include "kaacore/nodes_batch.h"
+
+namespace kaacore {
+
+template<typename T, typename Func>
+inline void
+batch_assign(
+    const std::vector<Node*>& nodes, const std::vector<T>& values,
+    const Node::DirtyFlagsType flags, Func&& assign
+)
+{
+    // `assign` returns true if node's value was changed,
+    // only those nodes get marked with dirty flags
+    thread_local std::vector<Node*> changed_nodes;
+    changed_nodes.clear();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (assign(nodes[i], values[i])) {
+            changed_nodes.push_back(nodes[i]);
+        }
+    }
+    Node::set_dirty_flags(changed_nodes, flags);
+}
+
+template<typename T, typename Func>
+inline std::vector<T>
+batch_collect(const std::vector<Node*>& nodes, Func&& get)
+{
+    std::vector<T> result;
+    result.reserve(nodes.size());
+    for (Node* node : nodes) {
+        result.push_back(get(node));
+    }
+    return result;
+}
+
+NodesBatch::NodesBatch(Scene& scene, const std::vector<NodeHandle>& handles)
+    : _scene(scene), _handles(handles)
+{}
+
+size_t
+NodesBatch::size() const
+{
+    return this->_handles.size();
+}
+
+std::vector<glm::dvec2>
+NodesBatch::positions() const
+{
+    return batch_collect<glm::dvec2>(this->_resolve(), [](Node* node) {
+        return node->_position;
+    });
+}
+
+void
+NodesBatch::positions(const std::vector<glm::dvec2>& positions)
+{
+    this->_check_values_size(positions.size());
+    batch_assign(
+        this->_resolve(), positions,
+        Node::DIRTY_DRAW_VERTICES_RECURSIVE |
+            Node::DIRTY_SPATIAL_INDEX_RECURSIVE |
+            Node::DIRTY_MODEL_MATRIX_RECURSIVE,
+        [](Node* node, const glm::dvec2& position) {
+            if (node->_type == NodeType::body or node->_in_hitbox_chain) {
+                // physics needs to be updated as well, it's rare
+                // enough to just use regular setter
+                node->position(position);
+                return false;
+            }
+            if (node->_position == position) {
+                return false;
+            }
+            node->_position = position;
+            return true;
+        }
+    );
+}
+
+std::vector<double>
+NodesBatch::rotations() const
+{
+    return batch_collect<double>(this->_resolve(), [](Node* node) {
+        return node->_rotation;
+    });
+}
+
+void
+NodesBatch::rotations(const std::vector<double>& rotations)
+{
+    this->_check_values_size(rotations.size());
+    batch_assign(
+        this->_resolve(), rotations,
+        Node::DIRTY_DRAW_VERTICES_RECURSIVE |
+            Node::DIRTY_SPATIAL_INDEX_RECURSIVE |
+            Node::DIRTY_MODEL_MATRIX_RECURSIVE,
+        [](Node* node, const double rotation) {
+            if (node->_type == NodeType::body or node->_in_hitbox_chain) {
+                // physics needs to be updated as well, it's rare
+                // enough to just use regular setter
+                node->rotation(rotation);
+                return false;
+            }
+            if (node->_rotation == rotation) {
+                return false;
+            }
+            node->_rotation = rotation;
+            return true;
+        }
+    );
+}
+
+std::vector<glm::dvec2>
+NodesBatch::scales() const
+{
+    return batch_collect<glm::dvec2>(this->_resolve(), [](Node* node) {
+        return node->_scale;
+    });
+}
+
+void
+NodesBatch::scales(const std::vector<glm::dvec2>& scales)
+{
+    this->_check_values_size(scales.size());
+    batch_assign(
+        this->_resolve(), scales,
+        Node::DIRTY_DRAW_VERTICES_RECURSIVE |
+            Node::DIRTY_SPATIAL_INDEX_RECURSIVE |
+            Node::DIRTY_MODEL_MATRIX_RECURSIVE,
+        [](Node* node, const glm::dvec2& scale) {
+            if (node->_type == NodeType::body or node->_in_hitbox_chain) {
+                node->scale(scale);
+                return false;
+            }
+            if (node->_scale == scale) {
+                return false;
+            }
+            node->_scale = scale;
+            return true;
+        }
+    );
+}
+
+std::vector<glm::dvec4>
+NodesBatch::colors() const
+{
+    return batch_collect<glm::dvec4>(this->_resolve(), [](Node* node) {
+        return node->_color;
+    });
+}
+
+void
+NodesBatch::colors(const std::vector<glm::dvec4>& colors)
+{
+    this->_check_values_size(colors.size());
+    batch_assign(
+        this->_resolve(), colors, Node::DIRTY_DRAW_VERTICES,
+        [](Node* node, const glm::dvec4& color) {
+            if (node->_color == color) {
+                return false;
+            }
+            node->_color = color;
+            return true;
+        }
+    );
+}
+
+std::vector<bool>
+NodesBatch::visible() const
+{
+    return batch_collect<bool>(this->_resolve(), [](Node* node) {
+        return node->_visible;
+    });
+}
+
+void
+NodesBatch::visible(const std::vector<bool>& visible)
+{
+    this->_check_values_size(visible.size());
+    batch_assign(
+        this->_resolve(), visible,
+        Node::DIRTY_DRAW_KEYS_RECURSIVE | Node::DIRTY_VISIBILITY_RECURSIVE,
+        [](Node* node, const bool visible) {
+            if (node->_visible == visible) {
+                return false;
+            }
+            node->_visible = visible;
+            return true;
+        }
+    );
+}
+
+std::vector<std::optional<int16_t>>
+NodesBatch::z_indices() const
+{
+    return batch_collect<std::optional<int16_t>>(
+        this->_resolve(), [](Node* node) { return node->_z_index; }
+    );
+}
+
+void
+NodesBatch::z_indices(const std::vector<std::optional<int16_t>>& z_indices)
+{
+    this->_check_values_size(z_indices.size());
+    batch_assign(
+        this->_resolve(), z_indices,
+        Node::DIRTY_DRAW_KEYS_RECURSIVE | Node::DIRTY_ORDERING_RECURSIVE,
+        [](Node* node, const std::optional<int16_t>& z_index) {
+            if (node->_z_index == z_index) {
+                return false;
+            }
+            node->_z_index = z_index;
+            return true;
+        }
+    );
+}
+
+std::vector<Sprite>
+NodesBatch::sprites() const
+{
+    return batch_collect<Sprite>(this->_resolve(), [](Node* node) {
+        return node->_sprite;
+    });
+}
+
+void
+NodesBatch::sprites(const std::vector<Sprite>& sprites)
+{
+    this->_check_values_size(sprites.size());
+    // sprite sets only non-recursive flags, but may also
+    // replace node's auto shape, so regular setter is used
+    const auto& nodes = this->_resolve();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i]->sprite(sprites[i]);
+    }
+}
+
+const std::vector<Node*>&
+NodesBatch::_resolve() const
+{
+    thread_local std::vector<Node*> nodes;
+    nodes.clear();
+    nodes.reserve(this->_handles.size());
+    for (size_t i = 0; i < this->_handles.size(); i++) {
+        Node* node = this->_scene.resolve(this->_handles[i]).get();
+        KAACORE_CHECK(
+            node != nullptr, "Node handle at index {} is stale.", i
+        );
+        nodes.push_back(node);
+    }
+    return nodes;
+}
+
+void
+NodesBatch::_check_values_size(const size_t size) const
+{
+    KAACORE_CHECK(
+        size == this->_handles.size(),
+        "Expected {} values, got {}.", this->_handles.size(), size
+    );
+}
+
+} // namespace kaacore
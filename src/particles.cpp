@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <chrono>
+
+#include "kaacore/exceptions.h"
+#include "kaacore/nodes.h"
+#include "kaacore/utils.h"
+
+#include "kaacore/particles.h"
+
+namespace kaacore {
+
+inline constexpr Node*
+container_node(const ParticleEmitterNode* particle_emitter)
+{
+    return container_of(particle_emitter, &Node::particle_emitter);
+}
+
+inline float
+to_seconds(const Duration duration)
+{
+    return std::chrono::duration<float>(duration).count();
+}
+
+ParticleEmitterNode::ParticleEmitterNode()
+    : _state(std::make_unique<State>())
+{
+    this->_state->random_engine.seed(get_random_engine()());
+}
+
+ParticleEmitterNode::~ParticleEmitterNode() {}
+
+void
+ParticleEmitterNode::_spawn_particle()
+{
+    std::uniform_real_distribution<float> spread_distribution{-1.f, 1.f};
+    const glm::fvec2 velocity_offset = {
+        spread_distribution(this->_state->random_engine),
+        spread_distribution(this->_state->random_engine)
+    };
+    const float lifetime =
+        to_seconds(this->_state->particle_lifetime) +
+        to_seconds(this->_state->particle_lifetime_spread) *
+            spread_distribution(this->_state->random_engine);
+
+    this->_state->positions.emplace_back(0.f, 0.f);
+    this->_state->velocities.push_back(
+        glm::fvec2(this->_state->initial_velocity) +
+        glm::fvec2(this->_state->velocity_spread) * velocity_offset
+    );
+    this->_state->colors.push_back(glm::fvec4(this->_state->start_color));
+    this->_state->sizes.push_back(this->_state->start_size);
+    this->_state->ages.push_back(0.f);
+    this->_state->lifetimes.push_back(std::max(lifetime, 0.f));
+}
+
+void
+ParticleEmitterNode::_kill_particle(const size_t index)
+{
+    const size_t last_index = this->_state->positions.size() - 1;
+    this->_state->positions[index] = this->_state->positions[last_index];
+    this->_state->velocities[index] = this->_state->velocities[last_index];
+    this->_state->colors[index] = this->_state->colors[last_index];
+    this->_state->sizes[index] = this->_state->sizes[last_index];
+    this->_state->ages[index] = this->_state->ages[last_index];
+    this->_state->lifetimes[index] = this->_state->lifetimes[last_index];
+
+    this->_state->positions.pop_back();
+    this->_state->velocities.pop_back();
+    this->_state->colors.pop_back();
+    this->_state->sizes.pop_back();
+    this->_state->ages.pop_back();
+    this->_state->lifetimes.pop_back();
+}
+
+void
+ParticleEmitterNode::_update_appearance(const size_t index)
+{
+    const float lifetime = this->_state->lifetimes[index];
+    const float progress =
+        lifetime > 0.f ? std::min(this->_state->ages[index] / lifetime, 1.f)
+                       : 1.f;
+    this->_state->colors[index] = glm::mix(
+        glm::fvec4(this->_state->start_color),
+        glm::fvec4(this->_state->end_color), progress
+    );
+    this->_state->sizes[index] = glm::mix(
+        float(this->_state->start_size), float(this->_state->end_size), progress
+    );
+}
+
+void
+ParticleEmitterNode::_mark_dirty()
+{
+    container_node(this)->set_dirty_flags(Node::DIRTY_DRAW_VERTICES);
+}
+
+void
+ParticleEmitterNode::step(const HighPrecisionDuration dt)
+{
+    const float dt_seconds = to_seconds(dt);
+    const bool had_particles = not this->_state->positions.empty();
+
+    // killed particle is replaced with the last one,
+    // so index is advanced only for the surviving ones
+    for (size_t i = 0; i < this->_state->ages.size();) {
+        this->_state->ages[i] += dt_seconds;
+        if (this->_state->ages[i] >= this->_state->lifetimes[i]) {
+            this->_kill_particle(i);
+            continue;
+        }
+        i++;
+    }
+
+    const glm::fvec2 velocity_delta =
+        glm::fvec2(this->_state->gravity) * dt_seconds;
+    for (size_t i = 0; i < this->_state->positions.size(); i++) {
+        this->_state->velocities[i] += velocity_delta;
+        this->_state->positions[i] += this->_state->velocities[i] * dt_seconds;
+        this->_update_appearance(i);
+    }
+
+    if (this->_state->emitting and this->_state->emission_rate > 0.) {
+        this->_state->emission_accumulator +=
+            this->_state->emission_rate * dt_seconds;
+        const uint32_t emitted_count = this->_state->emission_accumulator;
+        this->_state->emission_accumulator -= emitted_count;
+        this->emit(emitted_count);
+    }
+
+    if (had_particles or not this->_state->positions.empty()) {
+        this->_mark_dirty();
+    }
+}
+
+void
+ParticleEmitterNode::emit(const uint32_t count)
+{
+    const size_t spawned_count = std::min<size_t>(
+        count, this->_state->max_particles - this->_state->positions.size()
+    );
+    if (spawned_count == 0) {
+        return;
+    }
+
+    const size_t new_size = this->_state->positions.size() + spawned_count;
+    this->_state->positions.reserve(new_size);
+    this->_state->velocities.reserve(new_size);
+    this->_state->colors.reserve(new_size);
+    this->_state->sizes.reserve(new_size);
+    this->_state->ages.reserve(new_size);
+    this->_state->lifetimes.reserve(new_size);
+    for (size_t i = 0; i < spawned_count; i++) {
+        this->_spawn_particle();
+    }
+    this->_mark_dirty();
+}
+
+void
+ParticleEmitterNode::clear()
+{
+    if (this->_state->positions.empty()) {
+        return;
+    }
+    this->_state->positions.clear();
+    this->_state->velocities.clear();
+    this->_state->colors.clear();
+    this->_state->sizes.clear();
+    this->_state->ages.clear();
+    this->_state->lifetimes.clear();
+    this->_mark_dirty();
+}
+
+void
+ParticleEmitterNode::seed(const uint32_t seed)
+{
+    this->_state->random_engine.seed(seed);
+}
+
+size_t
+ParticleEmitterNode::particles_count() const
+{
+    return this->_state->positions.size();
+}
+
+const std::vector<glm::fvec2>&
+ParticleEmitterNode::positions() const
+{
+    return this->_state->positions;
+}
+
+const std::vector<glm::fvec2>&
+ParticleEmitterNode::velocities() const
+{
+    return this->_state->velocities;
+}
+
+const std::vector<glm::fvec4>&
+ParticleEmitterNode::colors() const
+{
+    return this->_state->colors;
+}
+
+const std::vector<float>&
+ParticleEmitterNode::sizes() const
+{
+    return this->_state->sizes;
+}
+
+const std::vector<float>&
+ParticleEmitterNode::ages() const
+{
+    return this->_state->ages;
+}
+
+VerticesIndicesVectorPair
+ParticleEmitterNode::make_vertices_indices(
+    const AffineTransformation<float>& model_matrix, const glm::fvec4& color
+) const
+{
+    const size_t count = this->_state->positions.size();
+    std::vector<StandardVertexData> vertices(count * 4);
+    std::vector<VertexIndex> indices(count * 6);
+
+    std::vector<std::pair<glm::fvec2, glm::fvec2>> frames_uv_rects;
+    for (const auto& frame : this->_state->sprite_frames) {
+        const auto display_rect = frame.get_display_rect();
+        frames_uv_rects.emplace_back(
+            glm::fvec2(display_rect.first), glm::fvec2(display_rect.second)
+        );
+    }
+    if (frames_uv_rects.empty()) {
+        frames_uv_rects.emplace_back(glm::fvec2{0., 0.}, glm::fvec2{1., 1.});
+    }
+    const size_t frames_count = frames_uv_rects.size();
+
+    const glm::fvec2 x_axis = model_matrix.x_axis;
+    const glm::fvec2 y_axis = model_matrix.y_axis;
+    const glm::fvec2 translation = model_matrix.translation;
+
+    for (size_t i = 0; i < count; i++) {
+        const glm::fvec2 center = translation +
+                                  x_axis * this->_state->positions[i].x +
+                                  y_axis * this->_state->positions[i].y;
+        const float half_size = 0.5f * this->_state->sizes[i];
+        const glm::fvec2 half_x = x_axis * half_size;
+        const glm::fvec2 half_y = y_axis * half_size;
+        const glm::fvec4 particle_color = this->_state->colors[i] * color;
+
+        const float progress =
+            this->_state->lifetimes[i] > 0.f
+                ? this->_state->ages[i] / this->_state->lifetimes[i]
+                : 1.f;
+        const auto& uv_rect = frames_uv_rects[std::min<size_t>(
+            progress * frames_count, frames_count - 1
+        )];
+
+        StandardVertexData* quad = &vertices[i * 4];
+        const glm::fvec2 corners[4] = {
+            center - half_x - half_y, center + half_x - half_y,
+            center + half_x + half_y, center - half_x + half_y
+        };
+        const glm::fvec2 corners_uv[4] = {
+            uv_rect.first,
+            {uv_rect.second.x, uv_rect.first.y},
+            uv_rect.second,
+            {uv_rect.first.x, uv_rect.second.y}
+        };
+        for (size_t corner = 0; corner < 4; corner++) {
+            quad[corner].xyz = {corners[corner].x, corners[corner].y, 0.f};
+            quad[corner].uv = corners_uv[corner];
+            quad[corner].rgba = particle_color;
+        }
+
+        const VertexIndex first_vertex = i * 4;
+        VertexIndex* quad_indices = &indices[i * 6];
+        quad_indices[0] = first_vertex;
+        quad_indices[1] = first_vertex + 2;
+        quad_indices[2] = first_vertex + 1;
+        quad_indices[3] = first_vertex;
+        quad_indices[4] = first_vertex + 3;
+        quad_indices[5] = first_vertex + 2;
+    }
+
+    return {std::move(vertices), std::move(indices)};
+}
+
+bool
+ParticleEmitterNode::emitting() const
+{
+    return this->_state->emitting;
+}
+
+void
+ParticleEmitterNode::emitting(const bool emitting)
+{
+    this->_state->emitting = emitting;
+    this->_state->emission_accumulator = 0.;
+}
+
+double
+ParticleEmitterNode::emission_rate() const
+{
+    return this->_state->emission_rate;
+}
+
+void
+ParticleEmitterNode::emission_rate(const double emission_rate)
+{
+    KAACORE_CHECK(emission_rate >= 0., "Emission rate must not be negative.");
+    this->_state->emission_rate = emission_rate;
+}
+
+uint32_t
+ParticleEmitterNode::max_particles() const
+{
+    return this->_state->max_particles;
+}
+
+void
+ParticleEmitterNode::max_particles(const uint32_t max_particles)
+{
+    KAACORE_CHECK(
+        max_particles <= max_particles_per_emitter,
+        "Emitter can't hold more than {} particles.", max_particles_per_emitter
+    );
+    this->_state->max_particles = max_particles;
+    if (this->_state->positions.size() > max_particles) {
+        while (this->_state->positions.size() > max_particles) {
+            this->_kill_particle(this->_state->positions.size() - 1);
+        }
+        this->_mark_dirty();
+    }
+}
+
+Duration
+ParticleEmitterNode::particle_lifetime() const
+{
+    return this->_state->particle_lifetime;
+}
+
+void
+ParticleEmitterNode::particle_lifetime(const Duration particle_lifetime)
+{
+    this->_state->particle_lifetime = particle_lifetime;
+}
+
+Duration
+ParticleEmitterNode::particle_lifetime_spread() const
+{
+    return this->_state->particle_lifetime_spread;
+}
+
+void
+ParticleEmitterNode::particle_lifetime_spread(
+    const Duration particle_lifetime_spread
+)
+{
+    this->_state->particle_lifetime_spread = particle_lifetime_spread;
+}
+
+glm::dvec2
+ParticleEmitterNode::initial_velocity() const
+{
+    return this->_state->initial_velocity;
+}
+
+void
+ParticleEmitterNode::initial_velocity(const glm::dvec2& initial_velocity)
+{
+    this->_state->initial_velocity = initial_velocity;
+}
+
+glm::dvec2
+ParticleEmitterNode::velocity_spread() const
+{
+    return this->_state->velocity_spread;
+}
+
+void
+ParticleEmitterNode::velocity_spread(const glm::dvec2& velocity_spread)
+{
+    this->_state->velocity_spread = velocity_spread;
+}
+
+glm::dvec2
+ParticleEmitterNode::gravity() const
+{
+    return this->_state->gravity;
+}
+
+void
+ParticleEmitterNode::gravity(const glm::dvec2& gravity)
+{
+    this->_state->gravity = gravity;
+}
+
+glm::dvec4
+ParticleEmitterNode::start_color() const
+{
+    return this->_state->start_color;
+}
+
+void
+ParticleEmitterNode::start_color(const glm::dvec4& start_color)
+{
+    this->_state->start_color = start_color;
+}
+
+glm::dvec4
+ParticleEmitterNode::end_color() const
+{
+    return this->_state->end_color;
+}
+
+void
+ParticleEmitterNode::end_color(const glm::dvec4& end_color)
+{
+    this->_state->end_color = end_color;
+}
+
+double
+ParticleEmitterNode::start_size() const
+{
+    return this->_state->start_size;
+}
+
+void
+ParticleEmitterNode::start_size(const double start_size)
+{
+    this->_state->start_size = start_size;
+}
+
+double
+ParticleEmitterNode::end_size() const
+{
+    return this->_state->end_size;
+}
+
+void
+ParticleEmitterNode::end_size(const double end_size)
+{
+    this->_state->end_size = end_size;
+}
+
+const std::vector<Sprite>&
+ParticleEmitterNode::sprite_frames() const
+{
+    return this->_state->sprite_frames;
+}
+
+void
+ParticleEmitterNode::sprite_frames(const std::vector<Sprite>& sprite_frames)
+{
+    for (const auto& frame : sprite_frames) {
+        KAACORE_CHECK(
+            frame.texture == sprite_frames.front().texture,
+            "All sprite frames must share the same texture."
+        );
+    }
+    this->_state->sprite_frames = sprite_frames;
+
+    // texture is a part of draw bucket key, so it's kept on the node
+    Node* node = container_node(this);
+    node->sprite(sprite_frames.empty() ? Sprite{} : sprite_frames.front());
+    this->_mark_dirty();
+}
+
+} // namespace kaacore
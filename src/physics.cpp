@@ -22,6 +22,7 @@ extern "C"
 #include "kaacore/geometry.h"
 #include "kaacore/log.h"
 #include "kaacore/nodes.h"
+#include "kaacore/scenes.h"
 #include "kaacore/utils.h"
 
 #include "kaacore/physics.h"
@@ -1164,6 +1165,193 @@ BodyNode::set_position_update_callback(PositionUpdateCallback callback)
     cpBodySetPositionUpdateFunc(this->_cp_body, _position_update_wrapper);
 }
 
+BodyNodesBatch::BodyNodesBatch(
+    Scene& scene, const std::vector<NodeHandle>& handles
+)
+    : _scene(scene), _handles(handles)
+{}
+
+size_t
+BodyNodesBatch::size() const
+{
+    return this->_handles.size();
+}
+
+std::vector<glm::dvec2>
+BodyNodesBatch::positions() const
+{
+    const auto& bodies = this->_resolve();
+    std::vector<glm::dvec2> positions;
+    positions.reserve(bodies.size());
+    for (const BodyNode* body : bodies) {
+        positions.push_back(convert_vector(cpBodyGetPosition(body->_cp_body)));
+    }
+    return positions;
+}
+
+void
+BodyNodesBatch::positions(const std::vector<glm::dvec2>& positions)
+{
+    this->_check_values_size(positions.size());
+    const auto& bodies = this->_resolve();
+    thread_local std::vector<Node*> changed_nodes;
+    changed_nodes.clear();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        Node* node = container_node(bodies[i]);
+        if (node->_position != positions[i]) {
+            node->_position = positions[i];
+            changed_nodes.push_back(node);
+        }
+        cpBodySetPosition(bodies[i]->_cp_body, convert_vector(positions[i]));
+    }
+    Node::set_dirty_flags(
+        changed_nodes, Node::DIRTY_DRAW_VERTICES_RECURSIVE |
+                           Node::DIRTY_SPATIAL_INDEX_RECURSIVE |
+                           Node::DIRTY_MODEL_MATRIX_RECURSIVE
+    );
+}
+
+std::vector<glm::dvec2>
+BodyNodesBatch::velocities() const
+{
+    const auto& bodies = this->_resolve();
+    std::vector<glm::dvec2> velocities;
+    velocities.reserve(bodies.size());
+    for (const BodyNode* body : bodies) {
+        velocities.push_back(convert_vector(cpBodyGetVelocity(body->_cp_body))
+        );
+    }
+    return velocities;
+}
+
+void
+BodyNodesBatch::velocities(const std::vector<glm::dvec2>& velocities)
+{
+    this->_check_values_size(velocities.size());
+    const auto& bodies = this->_resolve();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        cpBodySetVelocity(bodies[i]->_cp_body, convert_vector(velocities[i]));
+    }
+}
+
+std::vector<double>
+BodyNodesBatch::angular_velocities() const
+{
+    const auto& bodies = this->_resolve();
+    std::vector<double> angular_velocities;
+    angular_velocities.reserve(bodies.size());
+    for (const BodyNode* body : bodies) {
+        angular_velocities.push_back(cpBodyGetAngularVelocity(body->_cp_body));
+    }
+    return angular_velocities;
+}
+
+void
+BodyNodesBatch::angular_velocities(
+    const std::vector<double>& angular_velocities
+)
+{
+    this->_check_values_size(angular_velocities.size());
+    const auto& bodies = this->_resolve();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        cpBodySetAngularVelocity(bodies[i]->_cp_body, angular_velocities[i]);
+    }
+}
+
+std::vector<glm::dvec2>
+BodyNodesBatch::forces() const
+{
+    const auto& bodies = this->_resolve();
+    std::vector<glm::dvec2> forces;
+    forces.reserve(bodies.size());
+    for (const BodyNode* body : bodies) {
+        forces.push_back(convert_vector(cpBodyGetForce(body->_cp_body)));
+    }
+    return forces;
+}
+
+void
+BodyNodesBatch::forces(const std::vector<glm::dvec2>& forces)
+{
+    this->_check_values_size(forces.size());
+    const auto& bodies = this->_resolve();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        cpBodySetForce(bodies[i]->_cp_body, convert_vector(forces[i]));
+    }
+}
+
+std::vector<bool>
+BodyNodesBatch::sleeping() const
+{
+    const auto& bodies = this->_resolve();
+    std::vector<bool> sleeping;
+    sleeping.reserve(bodies.size());
+    for (const BodyNode* body : bodies) {
+        sleeping.push_back(cpBodyIsSleeping(body->_cp_body));
+    }
+    return sleeping;
+}
+
+void
+BodyNodesBatch::sleeping(const std::vector<bool>& sleeping)
+{
+    this->_check_values_size(sleeping.size());
+    const auto& bodies = this->_resolve();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        if (sleeping[i]) {
+            cpBodySleep(bodies[i]->_cp_body);
+        } else {
+            cpBodyActivate(bodies[i]->_cp_body);
+        }
+    }
+}
+
+void
+BodyNodesBatch::apply_impulses(const std::vector<glm::dvec2>& impulses)
+{
+    // impulses are applied at bodies' center of gravity
+    this->_check_values_size(impulses.size());
+    const auto& bodies = this->_resolve();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        cpBody* cp_body = bodies[i]->_cp_body;
+        cpBodyApplyImpulseAtWorldPoint(
+            cp_body, convert_vector(impulses[i]),
+            cpBodyLocalToWorld(cp_body, cpBodyGetCenterOfGravity(cp_body))
+        );
+    }
+}
+
+const std::vector<BodyNode*>&
+BodyNodesBatch::_resolve() const
+{
+    thread_local std::vector<BodyNode*> bodies;
+    bodies.clear();
+    bodies.reserve(this->_handles.size());
+    for (size_t i = 0; i < this->_handles.size(); i++) {
+        Node* node = this->_scene.resolve(this->_handles[i]).get();
+        KAACORE_CHECK(node != nullptr, "Node handle at index {} is stale.", i);
+        KAACORE_CHECK(
+            node->_type == NodeType::body,
+            "Node at index {} is not a body node.", i
+        );
+        KAACORE_ASSERT(
+            node->body._cp_body != nullptr,
+            "Body node has invalid internal state."
+        );
+        bodies.push_back(&node->body);
+    }
+    return bodies;
+}
+
+void
+BodyNodesBatch::_check_values_size(const size_t size) const
+{
+    KAACORE_CHECK(
+        size == this->_handles.size(), "Expected {} values, got {}.",
+        this->_handles.size(), size
+    );
+}
+
 CpShapeUniquePtr
 prepare_hitbox_shape(const Shape& shape, const Transformation& transformation)
 {
@@ -1229,7 +1417,8 @@ HitboxNode::update_physics_shape()
     Node* node = container_node(this);
     cpShape* new_cp_shape;
     auto transformation = calculate_inherited_hitbox_transformation(node);
-    new_cp_shape = prepare_hitbox_shape(node->_shape, transformation).release();
+    new_cp_shape =
+        prepare_hitbox_shape(*node->_shape, transformation).release();
     KAACORE_LOG_DEBUG(
         "Updating hitbox node {} shape (cpShape: {})", fmt::ptr(node),
         fmt::ptr(new_cp_shape)
@@ -1280,6 +1469,19 @@ HitboxNode::update_physics_shape()
     }
 
     this->_cp_shape = new_cp_shape;
+    this->_cp_shape_transformation = transformation;
+}
+
+void
+HitboxNode::prepare_physics_shape()
+{
+    // shape is recreated only if parents' transformation has changed
+    // since it was prepared, e.g. with `Node::prepare_subtree`
+    auto transformation =
+        calculate_inherited_hitbox_transformation(container_node(this));
+    if (not(transformation == this->_cp_shape_transformation)) {
+        this->update_physics_shape();
+    }
 }
 
 void
@@ -1289,7 +1491,7 @@ HitboxNode::attach_to_simulation()
         this->_cp_shape != nullptr, "Invalid internal state of hitbox."
     );
     // we might need to adjust for parents' transformation
-    this->update_physics_shape();
+    this->prepare_physics_shape();
     Node* node = container_node(this);
     KAACORE_LOG_DEBUG(
         "Attaching hitbox node {} to simulation (body) (cpShape: {})",
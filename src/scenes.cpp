@@ -14,17 +14,24 @@
 
 namespace kaacore {
 
-Scene::Scene() : timers(this)
+// below that many nodes per worker, threads synchronization
+// costs more than generating vertices
+constexpr size_t parallel_vertices_min_range_size = 64;
+
+Scene::Scene() : timers(this), streaming(this)
 {
     this->root_node._scene = this;
     this->handle_add_node_to_tree(&this->root_node);
+    this->_nodes_preorder_index.rebuild(&this->root_node);
 }
 
 Scene::~Scene()
 {
-    while (not this->root_node._children.empty()) {
-        delete this->root_node._children[0];
-    }
+    this->_nodes_preorder_index.invalidate();
+    this->_nodes_lifetime_queue.clear();
+    this->_nodes_groups_index.clear();
+    this->_nodes_handles_registry.clear();
+    this->root_node._delete_children();
     KAACORE_ASSERT_TERMINATE(
         this->simulations_registry.empty(),
         "Simulation registry not empty on scene deletion."
@@ -44,14 +51,23 @@ Scene::build_processing_queue()
     processing_queue.clear();
     KAACORE_LOG_TRACE("Building processing queue");
 
-    processing_queue.push_back(&this->root_node);
-    size_t i = 0;
-    while (i < processing_queue.size()) {
-        Node* node = processing_queue[i];
-        for (auto child_node : node->children()) {
-            processing_queue.push_back(child_node);
+    if (not this->_nodes_preorder_index.is_valid) {
+        this->_nodes_preorder_index.rebuild(&this->root_node);
+    }
+
+    // preorder keeps parents ahead of their children,
+    // subtrees of nodes marked to delete are skipped
+    const auto& nodes = this->_nodes_preorder_index.nodes;
+    processing_queue.reserve(nodes.size());
+    size_t position = 0;
+    while (position < nodes.size()) {
+        Node* node = nodes[position];
+        if (node->_marked_to_delete) {
+            position += node->_subtree_size;
+            continue;
         }
-        i++;
+        processing_queue.push_back(node);
+        position++;
     }
     KAACORE_LOG_DEBUG("Nodes to process count: {}", processing_queue.size());
     return processing_queue;
@@ -82,26 +98,31 @@ Scene::process_nodes(
     CounterStatAutoPusher transitions_counter{
         "scene.transitions_processed:count"
     };
+    this->_nodes_lifetime_queue.advance(dt);
+    while (Node* node = this->_nodes_lifetime_queue.pop_expired()) {
+        KAACORE_ASSERT(not node->_marked_to_delete, "");
+        node->_lifetime = 0us;
+        node->_mark_to_delete();
+    }
+
     for (Node* node : processing_queue) {
         if (node->_marked_to_delete) {
             continue;
         }
 
-        if (node->_lifetime > 0us) {
-            if ((node->_lifetime -= std::min(dt, node->_lifetime)) == 0us) {
-                KAACORE_ASSERT(not node->_marked_to_delete, "");
-                node->_mark_to_delete();
-                continue;
-            }
-        }
-
         if (node->_type == NodeType::body) {
             node->body.sync_simulation_position();
             node->body.sync_simulation_rotation();
         }
+        if (node->_offscreen_pause == OffscreenUpdatePolicy::pause_all) {
+            continue;
+        }
 
-        if (node->_transitions_manager) {
-            node->_transitions_manager.step(node, dt);
+        if (node->_type == NodeType::particle_emitter) {
+            node->particle_emitter.step(dt);
+        }
+        if (node->_cold_data and node->_cold_data->transitions_manager) {
+            node->_cold_data->transitions_manager.step(node, dt);
             transitions_counter += 1;
         }
     }
@@ -124,6 +145,7 @@ Scene::resolve_spatial_index_changes(const Scene::NodesQueue& processing_queue)
             spatial_updates_counter += 1;
         }
     }
+    this->spatial_index.flush_updates();
 }
 
 void
@@ -131,28 +153,48 @@ Scene::update_nodes_drawing_queue(const NodesQueue& processing_queue)
 {
     KAACORE_LOG_TRACE("Starting process_nodes_drawing()");
     StopwatchStatAutoPusher stopwatch{"scene.nodes_drawing:time"};
-
+    this->_resolve_offscreen_pauses(processing_queue);
+
+    // draw keys and model matrices may depend on parents so they are
+    // resolved serially, vertices generation only reads node's own state
+    // and is spread across workers pool, modifications are enqueued
+    // in processing queue order afterwards, so result is deterministic
+    thread_local std::vector<std::pair<Node*, DrawUnitModificationPack>>
+        pending_mods;
+    pending_mods.clear();
     for (Node* node : processing_queue) {
+        if (node->_offscreen_pause != OffscreenUpdatePolicy::always) {
+            // dirty flags are kept, so draw unit
+            // is updated once node becomes visible again
+            if (node->_draw_unit_data.current_key and
+                not node->_marked_to_delete) {
+                // node could have left visible area since its draw unit
+                // was last updated, remove it instead of leaving it stale,
+                // it will be inserted again once node is resumed
+                pending_mods.emplace_back(
+                    node, DrawUnitModificationPack{
+                              std::nullopt, node->calculate_draw_unit_removal()
+                          }
+                );
+                node->clear_draw_unit_updates(std::nullopt);
+                node->set_dirty_flags(Node::DIRTY_DRAW_KEYS);
+            }
+            continue;
+        }
         if (not node->_marked_to_delete) {
-            auto mods_pack = node->calculate_draw_unit_updates();
+            if (node->_type == NodeType::tilemap) {
+                // chunk nodes come after tilemap in the queue,
+                // so rebuilt meshes are drawn in the same frame
+                node->tilemap.rebuild_dirty_chunks();
+            }
+            auto mods_pack = node->calculate_draw_unit_updates(true);
             if (mods_pack) {
                 KAACORE_LOG_TRACE(
                     "DrawUnit modifications detected for node: {}",
                     fmt::ptr(node)
                 );
-                auto new_lookup_key = mods_pack.new_lookup_key();
-                if (mods_pack.upsert_mod) {
-                    // TODO enque modification should accept pack
-                    this->draw_queue.enqueue_modification(
-                        std::move(*mods_pack.upsert_mod)
-                    );
-                }
-                if (mods_pack.remove_mod) {
-                    this->draw_queue.enqueue_modification(
-                        std::move(*mods_pack.remove_mod)
-                    );
-                }
-                node->clear_draw_unit_updates(new_lookup_key);
+                node->clear_draw_unit_updates(mods_pack.new_lookup_key());
+                pending_mods.emplace_back(node, std::move(mods_pack));
             }
         }
         node->clear_dirty_flags(
@@ -160,6 +202,119 @@ Scene::update_nodes_drawing_queue(const NodesQueue& processing_queue)
             Node::DIRTY_DRAW_VERTICES_RECURSIVE
         );
     }
+
+    // workers have their own thread_local instance, pass it explicitly
+    auto& mods = pending_mods;
+    get_engine()->workers_pool->parallel_for(
+        mods.size(), parallel_vertices_min_range_size,
+        [&mods](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                auto& [node, mods_pack] = mods[i];
+                if (mods_pack.upsert_mod) {
+                    node->calculate_draw_unit_vertices(*mods_pack.upsert_mod);
+                }
+            }
+        }
+    );
+
+    for (auto& [node, mods_pack] : pending_mods) {
+        if (mods_pack.upsert_mod) {
+            // TODO enque modification should accept pack
+            this->draw_queue.enqueue_modification(
+                std::move(*mods_pack.upsert_mod)
+            );
+        }
+        if (mods_pack.remove_mod) {
+            this->draw_queue.enqueue_modification(
+                std::move(*mods_pack.remove_mod)
+            );
+        }
+    }
+    pending_mods.clear();
+}
+
+void
+Scene::_resolve_offscreen_pauses(const NodesQueue& processing_queue)
+{
+    CounterStatAutoPusher paused_counter{"scene.offscreen_paused_nodes:count"};
+    // nodes could be added or removed since processing queue was built
+    if (not this->_nodes_preorder_index.is_valid) {
+        this->_nodes_preorder_index.rebuild(&this->root_node);
+    }
+    VisibleAreasCache visible_areas;
+    size_t paused_subtree_end = 0;
+    OffscreenUpdatePolicy subtree_pause = OffscreenUpdatePolicy::always;
+
+    // queue is in preorder, so positions in preorder index are increasing
+    for (Node* node : processing_queue) {
+        const size_t position = node->_preorder_position;
+        if (position >= paused_subtree_end and
+            node->_offscreen_update_policy != OffscreenUpdatePolicy::always and
+            not this->_is_subtree_visible(node, visible_areas)) {
+            paused_subtree_end = position + node->_subtree_size;
+            subtree_pause = node->_offscreen_update_policy;
+        }
+
+        if (position < paused_subtree_end) {
+            node->_set_offscreen_pause(subtree_pause);
+            paused_counter += 1;
+        } else {
+            node->_set_offscreen_pause(OffscreenUpdatePolicy::always);
+        }
+    }
+}
+
+bool
+Scene::_is_subtree_visible(
+    Node* const subtree_root, VisibleAreasCache& visible_areas
+)
+{
+    subtree_root->recalculate_ordering_data();
+    thread_local std::vector<BoundingBox<double>> subtree_visible_areas;
+    subtree_visible_areas.clear();
+    subtree_root->_ordering_data.calculated_viewports.each_active_z_index(
+        [&](const int16_t z_index) {
+            auto& visible_area = visible_areas[z_index - min_viewport_z_index];
+            if (not visible_area) {
+                visible_area =
+                    this->viewports[z_index].camera.visible_area_bounding_box();
+            }
+            subtree_visible_areas.push_back(*visible_area);
+        }
+    );
+
+    // subtree occupies contiguous range of preorder index
+    thread_local std::vector<glm::dvec2> bounding_points;
+    const auto& nodes = this->_nodes_preorder_index.nodes;
+    const size_t subtree_begin = subtree_root->_preorder_position;
+    const size_t subtree_end = subtree_begin + subtree_root->_subtree_size;
+    size_t position = subtree_begin;
+    while (position < subtree_end) {
+        Node* node = nodes[position];
+        if (node->_marked_to_delete) {
+            position += node->_subtree_size;
+            continue;
+        }
+        position++;
+        auto& spatial_data = node->_spatial_data;
+        if (not spatial_data.is_indexed) {
+            spatial_data.refresh();
+        }
+        BoundingBox<double> bounding_box = spatial_data.bounding_box;
+        if (node->query_dirty_flags(Node::DIRTY_SPATIAL_INDEX) or
+            bounding_box.is_nan()) {
+            // spatial index relies on dirty flag to update its entry,
+            // so data of indexed nodes is left to be refreshed there
+            bounding_box = spatial_data.calculate_bounding_box(bounding_points);
+        }
+
+        for (const auto& visible_area : subtree_visible_areas) {
+            if (visible_area.intersects(bounding_box)) {
+                return true;
+            }
+        }
+    }
+    return false;
 }
 
 void
@@ -176,10 +331,49 @@ Scene::draw(
 void
 Scene::remove_marked_nodes()
 {
-    // iterate in reverse order to delete children nodes first
-    for (auto it = this->_nodes_remove_queue.rbegin();
-         it != this->_nodes_remove_queue.rend(); it++) {
-        delete (*it);
+    if (this->_nodes_remove_queue.empty()) {
+        return;
+    }
+    StopwatchStatAutoPusher stopwatch{"scene.remove_nodes:time"};
+    this->_nodes_preorder_index.remove_marked(this->_nodes_remove_queue);
+
+    // Only top-most marked nodes are deleted directly, the rest of
+    // marked nodes are deleted together with their ancestors.
+    // Removed subtrees are detached from surviving parents in bulk,
+    // so every parent's children vector is compacted only once.
+    thread_local std::vector<Node*> subtree_roots;
+    thread_local std::vector<Node*> affected_parents;
+    subtree_roots.clear();
+    affected_parents.clear();
+    for (Node* node : this->_nodes_remove_queue) {
+        if (node->_is_marked_subtree_root()) {
+            subtree_roots.push_back(node);
+            affected_parents.push_back(node->_parent);
+        }
+    }
+
+    std::sort(affected_parents.begin(), affected_parents.end());
+    affected_parents.erase(
+        std::unique(affected_parents.begin(), affected_parents.end()),
+        affected_parents.end()
+    );
+    for (Node* parent : affected_parents) {
+        auto& children = parent->_children;
+        children.erase(
+            std::remove_if(
+                children.begin(), children.end(),
+                [](const Node* child) { return child->_marked_to_delete; }
+            ),
+            children.end()
+        );
+        for (size_t i = 0; i < children.size(); i++) {
+            children[i]->_index_in_parent = i;
+        }
+    }
+
+    for (Node* node : subtree_roots) {
+        node->_parent = nullptr;
+        delete node;
     }
     this->_nodes_remove_queue.clear();
 }
@@ -283,12 +477,43 @@ Scene::handle_add_node_to_tree(Node* node)
     KAACORE_LOG_DEBUG("Adding node to scene tree: {}", fmt::ptr(node));
     KAACORE_ASSERT(node->_scene != nullptr, "Node does not belong to a scene");
     this->spatial_index.start_tracking(node);
+    if (node->_lifetime > 0us) {
+        this->_nodes_lifetime_queue.schedule(node, node->_lifetime);
+    }
+    this->_nodes_groups_index.add(node);
     node->_scene_tree_id = this->_node_scene_tree_id_counter.fetch_add(
                                1, std::memory_order_relaxed
                            ) +
                            1;
 }
 
+void
+Scene::handle_add_nodes_to_tree(const std::vector<Node*>& nodes)
+{
+    KAACORE_LOG_DEBUG("Adding {} nodes to scene tree", nodes.size());
+    if (nodes.empty()) {
+        return;
+    }
+    // reserve whole range of ids at once
+    uint64_t scene_tree_id = this->_node_scene_tree_id_counter.fetch_add(
+        nodes.size(), std::memory_order_relaxed
+    );
+    for (Node* node : nodes) {
+        KAACORE_ASSERT(
+            node->_scene == this, "Node does not belong to this scene"
+        );
+        if (node->_lifetime > 0us) {
+            this->_nodes_lifetime_queue.schedule(node, node->_lifetime);
+        }
+        this->_nodes_groups_index.add(node);
+        node->_scene_tree_id = ++scene_tree_id;
+    }
+    this->spatial_index.start_tracking(nodes);
+    // Physics objects are attached node by node in `_on_enter_scene`,
+    // chipmunk has no bulk insertion. Objects added while space is
+    // locked are still collected into a single post-step callback.
+}
+
 void
 Scene::handle_remove_node_from_tree(Node* node)
 {
@@ -296,6 +521,13 @@ Scene::handle_remove_node_from_tree(Node* node)
     KAACORE_ASSERT(node->_marked_to_delete, "Node should be marked to delete");
     this->_nodes_remove_queue.push_back(node);
     this->spatial_index.stop_tracking(node);
+    this->_nodes_groups_index.remove(node);
+    this->_nodes_handles_registry.release(node);
+    node->_set_offscreen_pause(OffscreenUpdatePolicy::always);
+    if (node->_lifetime_queue_position != NodesLifetimeQueue::unscheduled) {
+        node->_lifetime = this->_nodes_lifetime_queue.remaining(node);
+        this->_nodes_lifetime_queue.unschedule(node);
+    }
 
     if (auto mod = node->calculate_draw_unit_removal()) {
         KAACORE_LOG_DEBUG("Removing node from draw queue: {}", fmt::ptr(node));
@@ -304,6 +536,55 @@ Scene::handle_remove_node_from_tree(Node* node)
     }
 }
 
+NodePtr
+Scene::resolve(const NodeHandle& handle) const
+{
+    return this->_nodes_handles_registry.resolve(handle);
+}
+
+const std::vector<Node*>&
+Scene::group(const std::string& tag) const
+{
+    return this->_nodes_groups_index.group(tag);
+}
+
+size_t
+Scene::group_size(const std::string& tag) const
+{
+    return this->_nodes_groups_index.group_size(tag);
+}
+
+void
+Scene::delete_group(const std::string& tag)
+{
+    // marking node to delete removes it (and its tagged descendants)
+    // from the index, so iterate over a copy of the group
+    const std::vector<Node*> group = this->group(tag);
+    for (Node* node : group) {
+        if (not node->_marked_to_delete) {
+            node->_mark_to_delete();
+        }
+    }
+}
+
+void
+Scene::set_group_visible(const std::string& tag, const bool visible)
+{
+    for (Node* node : this->group(tag)) {
+        node->visible(visible);
+    }
+}
+
+void
+Scene::set_group_z_index(
+    const std::string& tag, const std::optional<int16_t>& z_index
+)
+{
+    for (Node* node : this->group(tag)) {
+        node->z_index(z_index);
+    }
+}
+
 Duration
 Scene::total_time() const
 {
@@ -0,0 +1,669 @@
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "kaacore/exceptions.h"
+#include "kaacore/files.h"
+#include "kaacore/log.h"
+#include "kaacore/nodes.h"
+#include "kaacore/textures.h"
+
+#include "kaacore/serialization.h"
+
+namespace kaacore {
+
+constexpr uint32_t no_texture = std::numeric_limits<uint32_t>::max();
+
+// per-node optional fields
+constexpr uint8_t snapshot_flag_z_index = 1u << 0;
+constexpr uint8_t snapshot_flag_visible = 1u << 1;
+constexpr uint8_t snapshot_flag_indexable = 1u << 2;
+constexpr uint8_t snapshot_flag_auto_shape = 1u << 3;
+constexpr uint8_t snapshot_flag_render_passes = 1u << 4;
+constexpr uint8_t snapshot_flag_viewports = 1u << 5;
+constexpr uint8_t snapshot_flag_stencil_mode = 1u << 6;
+
+class NodesSnapshotWriter {
+  public:
+    std::vector<uint8_t> buffer;
+
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+        this->buffer.insert(this->buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    void write_vector(const std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        this->write<uint32_t>(values.size());
+        const auto bytes = reinterpret_cast<const uint8_t*>(values.data());
+        this->buffer.insert(
+            this->buffer.end(), bytes, bytes + values.size() * sizeof(T)
+        );
+    }
+
+    void write_nodes(Node* const root);
+
+  private:
+    std::vector<std::string> _textures_paths;
+    std::unordered_map<std::string, uint32_t> _textures_indices;
+
+    void _write_node(Node* const node, const uint32_t children_count);
+    void _write_sprite(const Sprite& sprite);
+    void _write_shape(const Shape& shape);
+    void _write_type_specific(Node* const node);
+};
+
+class NodesSnapshotReader {
+  public:
+    NodesSnapshotReader(const uint8_t* data, const size_t size)
+        : _data(data), _size(size), _offset(0)
+    {}
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        this->_require(sizeof(T));
+        T value;
+        std::memcpy(&value, this->_data + this->_offset, sizeof(T));
+        this->_offset += sizeof(T);
+        return value;
+    }
+
+    template<typename T>
+    std::vector<T> read_vector()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const uint32_t count = this->read<uint32_t>();
+        this->_require(size_t(count) * sizeof(T));
+        std::vector<T> values(count);
+        std::memcpy(
+            values.data(), this->_data + this->_offset, count * sizeof(T)
+        );
+        this->_offset += count * sizeof(T);
+        return values;
+    }
+
+    NodeOwnerPtr read_nodes();
+
+  private:
+    const uint8_t* _data;
+    size_t _size;
+    size_t _offset;
+    std::vector<Sprite> _textures;
+
+    void _require(const size_t bytes_count) const;
+    void _read_node(Node* const node, const uint8_t flags);
+    Sprite _read_sprite();
+    Shape _read_shape();
+    void _read_type_specific(Node* const node);
+};
+
+void
+NodesSnapshotWriter::write_nodes(Node* const root)
+{
+    // textures paths are collected while writing nodes,
+    // so they are written to a separate buffer and placed
+    // in front of nodes afterwards
+    std::vector<uint8_t> header_buffer;
+    std::swap(header_buffer, this->buffer);
+    uint32_t nodes_count = 0;
+
+    std::vector<Node*> nodes_stack = {root};
+    while (not nodes_stack.empty()) {
+        Node* node = nodes_stack.back();
+        nodes_stack.pop_back();
+        nodes_count++;
+
+        // tilemap chunks are generated from tiles, which
+        // are saved together with the tilemap itself
+        std::vector<Node*> children;
+        if (node->_type != NodeType::tilemap) {
+            children = node->children();
+        }
+        this->_write_node(node, children.size());
+        nodes_stack.insert(
+            nodes_stack.end(), children.rbegin(), children.rend()
+        );
+    }
+
+    std::swap(header_buffer, this->buffer);
+    this->write(nodes_snapshot_magic);
+    this->write(nodes_snapshot_version);
+    this->write<uint32_t>(nodes_count);
+    this->write<uint32_t>(this->_textures_paths.size());
+    for (const auto& path : this->_textures_paths) {
+        this->write_vector(std::vector<char>(path.begin(), path.end()));
+    }
+    this->buffer.insert(
+        this->buffer.end(), header_buffer.begin(), header_buffer.end()
+    );
+}
+
+void
+NodesSnapshotWriter::_write_node(
+    Node* const node, const uint32_t children_count
+)
+{
+    uint8_t flags = 0;
+    if (node->_z_index) {
+        flags |= snapshot_flag_z_index;
+    }
+    if (node->_visible) {
+        flags |= snapshot_flag_visible;
+    }
+    if (node->_indexable) {
+        flags |= snapshot_flag_indexable;
+    }
+    if (node->_auto_shape) {
+        flags |= snapshot_flag_auto_shape;
+    }
+    const auto render_passes = node->render_passes();
+    if (render_passes) {
+        flags |= snapshot_flag_render_passes;
+    }
+    const auto viewports = node->viewports();
+    if (viewports) {
+        flags |= snapshot_flag_viewports;
+    }
+    const auto stencil_mode = node->stencil_mode();
+    if (stencil_mode) {
+        flags |= snapshot_flag_stencil_mode;
+    }
+
+    this->write<uint8_t>(static_cast<uint8_t>(node->_type));
+    this->write<uint8_t>(flags);
+    this->write<uint32_t>(children_count);
+    this->write(node->_position);
+    this->write(node->_rotation);
+    this->write(node->_scale);
+    this->write(node->_color);
+    this->write<uint8_t>(static_cast<uint8_t>(node->_origin_alignment));
+    this->write<double>(node->lifetime().count());
+    if (node->_z_index) {
+        this->write(*node->_z_index);
+    }
+    if (render_passes) {
+        this->write_vector(*render_passes);
+    }
+    if (viewports) {
+        this->write_vector(*viewports);
+    }
+    if (stencil_mode) {
+        this->write(stencil_mode->value());
+        this->write(stencil_mode->mask());
+        this->write(stencil_mode->test());
+        this->write(stencil_mode->stencil_fail_op());
+        this->write(stencil_mode->depth_fail_op());
+        this->write(stencil_mode->pass_op());
+    }
+
+    // text nodes generate their own shape and sprite
+    if (node->_type != NodeType::text) {
+        this->_write_sprite(node->_sprite);
+        if (not node->_auto_shape) {
+            this->_write_shape(*node->_shape);
+        }
+    }
+    this->_write_type_specific(node);
+}
+
+void
+NodesSnapshotWriter::_write_sprite(const Sprite& sprite)
+{
+    if (not sprite.has_texture()) {
+        this->write<uint32_t>(no_texture);
+        return;
+    }
+
+    auto image_texture = dynamic_cast<ImageTexture*>(sprite.texture.get());
+    KAACORE_CHECK(
+        image_texture != nullptr,
+        "Only sprites with textures loaded from files can be serialized."
+    );
+    auto [it, inserted] = this->_textures_indices.try_emplace(
+        image_texture->path, this->_textures_paths.size()
+    );
+    if (inserted) {
+        this->_textures_paths.push_back(image_texture->path);
+    }
+    this->write<uint32_t>(it->second);
+    this->write(sprite.origin);
+    this->write(sprite.dimensions);
+}
+
+void
+NodesSnapshotWriter::_write_shape(const Shape& shape)
+{
+    this->write<uint8_t>(static_cast<uint8_t>(shape.type));
+    if (not shape) {
+        return;
+    }
+    this->write_vector(shape.points);
+    this->write(shape.radius);
+    // shared geometry buffers are stored by value
+    this->write_vector(shape.get_indices());
+    this->write_vector(shape.get_vertices());
+    this->write(shape.vertices_bbox);
+    this->write_vector(shape.bounding_points);
+}
+
+void
+NodesSnapshotWriter::_write_type_specific(Node* const node)
+{
+    switch (node->_type) {
+        case NodeType::space: {
+            this->write(node->space.gravity());
+            this->write(node->space.damping());
+            this->write(node->space.sleeping_threshold());
+            break;
+        }
+        case NodeType::body: {
+            const auto body_type = node->body.body_type();
+            this->write(body_type);
+            // mass properties are available for dynamic bodies only
+            if (body_type == BodyNodeType::dynamic) {
+                this->write(node->body.mass());
+                this->write(node->body.moment());
+                this->write(node->body.center_of_gravity());
+            }
+            this->write(node->body.velocity());
+            this->write(node->body.angular_velocity());
+            break;
+        }
+        case NodeType::hitbox: {
+            this->write<uint64_t>(node->hitbox.trigger_id());
+            this->write<uint64_t>(node->hitbox.group());
+            this->write<uint64_t>(node->hitbox.mask());
+            this->write<uint64_t>(node->hitbox.collision_mask());
+            this->write<uint8_t>(node->hitbox.sensor());
+            this->write(node->hitbox.elasticity());
+            this->write(node->hitbox.friction());
+            this->write(node->hitbox.surface_velocity());
+            break;
+        }
+        case NodeType::text: {
+            // only default font is supported
+            const auto content = node->text.content();
+            const auto content_bytes =
+                reinterpret_cast<const uint8_t*>(content.data());
+            this->write(content.representation_size());
+            this->write_vector(std::vector<uint8_t>(
+                content_bytes,
+                content_bytes + content.length() *
+                                    size_t(content.representation_size())
+            ));
+            this->write(node->text.font_size());
+            this->write(node->text.line_width());
+            this->write(node->text.interline_spacing());
+            this->write(node->text.first_line_indent());
+            break;
+        }
+        case NodeType::particle_emitter: {
+            const auto& emitter = node->particle_emitter;
+            this->write<uint8_t>(emitter.emitting());
+            this->write(emitter.emission_rate());
+            this->write(emitter.max_particles());
+            this->write<double>(emitter.particle_lifetime().count());
+            this->write<double>(emitter.particle_lifetime_spread().count());
+            this->write(emitter.initial_velocity());
+            this->write(emitter.velocity_spread());
+            this->write(emitter.gravity());
+            this->write(emitter.start_color());
+            this->write(emitter.end_color());
+            this->write(emitter.start_size());
+            this->write(emitter.end_size());
+            this->write<uint32_t>(emitter.sprite_frames().size());
+            for (const auto& frame : emitter.sprite_frames()) {
+                this->_write_sprite(frame);
+            }
+            break;
+        }
+        case NodeType::tilemap: {
+            const auto& tilemap = node->tilemap;
+            this->write(tilemap.tile_size());
+            this->write(tilemap.chunk_size());
+            this->_write_sprite(tilemap.atlas());
+            const auto chunks_positions = tilemap.chunks_positions();
+            this->write<uint32_t>(chunks_positions.size());
+            for (const auto chunk_position : chunks_positions) {
+                this->write(chunk_position);
+                this->write_vector(tilemap.chunk_tiles(chunk_position));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void
+NodesSnapshotReader::_require(const size_t bytes_count) const
+{
+    KAACORE_CHECK(
+        this->_size - this->_offset >= bytes_count,
+        "Nodes snapshot is truncated."
+    );
+}
+
+NodeOwnerPtr
+NodesSnapshotReader::read_nodes()
+{
+    KAACORE_CHECK(
+        this->read<uint32_t>() == nodes_snapshot_magic,
+        "Invalid nodes snapshot header."
+    );
+    const auto version = this->read<uint16_t>();
+    KAACORE_CHECK(
+        version == nodes_snapshot_version,
+        "Unsupported nodes snapshot version: {}.", version
+    );
+    const auto nodes_count = this->read<uint32_t>();
+    KAACORE_CHECK(nodes_count > 0, "Nodes snapshot is empty.");
+    const auto textures_count = this->read<uint32_t>();
+    for (uint32_t i = 0; i < textures_count; i++) {
+        const auto path = this->read_vector<char>();
+        this->_textures.push_back(Sprite::load({path.begin(), path.end()}));
+    }
+
+    // each node is attached right after being created, so in case
+    // of an error all of the nodes read so far are owned by the root
+    NodeOwnerPtr root;
+    std::vector<std::pair<Node*, uint32_t>> parents_stack;
+    for (uint32_t i = 0; i < nodes_count; i++) {
+        const auto type = static_cast<NodeType>(this->read<uint8_t>());
+        KAACORE_CHECK(
+            type >= NodeType::basic and type <= NodeType::tilemap,
+            "Invalid node type in nodes snapshot."
+        );
+        const auto flags = this->read<uint8_t>();
+        const auto children_count = this->read<uint32_t>();
+        KAACORE_CHECK(
+            children_count < nodes_count - i,
+            "Invalid children count in nodes snapshot."
+        );
+
+        KAACORE_CHECK(
+            not parents_stack.empty() or not root,
+            "Nodes snapshot has multiple roots."
+        );
+        Node* node = new Node(type);
+        if (parents_stack.empty()) {
+            root = NodeOwnerPtr{node};
+        } else {
+            auto& [parent, remaining_children] = parents_stack.back();
+            node->_parent = parent;
+            node->_index_in_parent = parent->_children.size();
+            node->_root_distance = parent->_root_distance + 1;
+            parent->_children.push_back(node);
+            if (--remaining_children == 0) {
+                parents_stack.pop_back();
+            }
+        }
+        if (children_count > 0) {
+            node->_children.reserve(children_count);
+            parents_stack.emplace_back(node, children_count);
+        }
+        this->_read_node(node, flags);
+    }
+    KAACORE_CHECK(
+        parents_stack.empty() and this->_offset == this->_size,
+        "Nodes snapshot structure is corrupted."
+    );
+    return root;
+}
+
+void
+NodesSnapshotReader::_read_node(Node* const node, const uint8_t flags)
+{
+    node->position(this->read<glm::dvec2>());
+    node->rotation(this->read<double>());
+    node->scale(this->read<glm::dvec2>());
+    node->color(this->read<glm::dvec4>());
+    const auto alignment = this->read<uint8_t>();
+    // both 2-bit parts of alignment must be set, unless it's none
+    KAACORE_CHECK(
+        alignment == 0 or (alignment <= 0b1111 and (alignment & 0b0011) and
+                           (alignment & 0b1100)),
+        "Invalid alignment in nodes snapshot."
+    );
+    node->origin_alignment(static_cast<Alignment>(alignment));
+    node->lifetime(Duration(this->read<double>()));
+    node->visible(flags & snapshot_flag_visible);
+    node->indexable(flags & snapshot_flag_indexable);
+    if (flags & snapshot_flag_z_index) {
+        node->z_index(this->read<int16_t>());
+    }
+    if (flags & snapshot_flag_render_passes) {
+        const auto render_passes = this->read_vector<int16_t>();
+        node->render_passes(std::unordered_set<int16_t>{
+            render_passes.begin(), render_passes.end()
+        });
+    }
+    if (flags & snapshot_flag_viewports) {
+        const auto viewports = this->read_vector<int16_t>();
+        node->viewports(
+            std::unordered_set<int16_t>{viewports.begin(), viewports.end()}
+        );
+    }
+    if (flags & snapshot_flag_stencil_mode) {
+        const auto value = this->read<uint8_t>();
+        const auto mask = this->read<uint8_t>();
+        const auto test = this->read<StencilTest>();
+        const auto stencil_fail_op = this->read<StencilOp>();
+        const auto depth_fail_op = this->read<StencilOp>();
+        const auto pass_op = this->read<StencilOp>();
+        KAACORE_CHECK(
+            test >= StencilTest::disabled and test <= StencilTest::always,
+            "Invalid stencil test in nodes snapshot."
+        );
+        for (const auto op : {stencil_fail_op, depth_fail_op, pass_op}) {
+            KAACORE_CHECK(
+                op >= StencilOp::zero and op <= StencilOp::invert,
+                "Invalid stencil operation in nodes snapshot."
+            );
+        }
+        node->stencil_mode(StencilMode{
+            value, mask, test, stencil_fail_op, depth_fail_op, pass_op
+        });
+    }
+
+    if (node->_type != NodeType::text) {
+        const Sprite sprite = this->_read_sprite();
+        if (not(flags & snapshot_flag_auto_shape)) {
+            // setting shape first prevents sprite from replacing it
+            node->shape(this->_read_shape());
+        }
+        node->sprite(sprite);
+    }
+    this->_read_type_specific(node);
+}
+
+Sprite
+NodesSnapshotReader::_read_sprite()
+{
+    const auto texture_index = this->read<uint32_t>();
+    if (texture_index == no_texture) {
+        return Sprite{};
+    }
+    KAACORE_CHECK(
+        texture_index < this->_textures.size(),
+        "Invalid texture index in nodes snapshot."
+    );
+    Sprite sprite = this->_textures[texture_index];
+    sprite.origin = this->read<glm::dvec2>();
+    sprite.dimensions = this->read<glm::dvec2>();
+    return sprite;
+}
+
+Shape
+NodesSnapshotReader::_read_shape()
+{
+    const auto type = static_cast<ShapeType>(this->read<uint8_t>());
+    KAACORE_CHECK(
+        type >= ShapeType::none and type <= ShapeType::freeform,
+        "Invalid shape type in nodes snapshot."
+    );
+    if (type == ShapeType::none) {
+        return Shape{};
+    }
+    const auto points = this->read_vector<glm::dvec2>();
+    const auto radius = this->read<double>();
+    const auto indices = this->read_vector<VertexIndex>();
+    const auto vertices = this->read_vector<StandardVertexData>();
+    const auto vertices_bbox = this->read<BoundingBox<double>>();
+    const auto bounding_points = this->read_vector<glm::dvec2>();
+    return Shape{type,     points,        radius,         indices,
+                 vertices, vertices_bbox, bounding_points};
+}
+
+void
+NodesSnapshotReader::_read_type_specific(Node* const node)
+{
+    switch (node->_type) {
+        case NodeType::space: {
+            node->space.gravity(this->read<glm::dvec2>());
+            node->space.damping(this->read<double>());
+            node->space.sleeping_threshold(this->read<double>());
+            break;
+        }
+        case NodeType::body: {
+            const auto body_type = this->read<BodyNodeType>();
+            KAACORE_CHECK(
+                body_type == BodyNodeType::dynamic or
+                    body_type == BodyNodeType::kinematic or
+                    body_type == BodyNodeType::static_,
+                "Invalid body type in nodes snapshot."
+            );
+            node->body.body_type(body_type);
+            if (body_type == BodyNodeType::dynamic) {
+                node->body.mass(this->read<double>());
+                node->body.moment(this->read<double>());
+                node->body.center_of_gravity(this->read<glm::dvec2>());
+            }
+            node->body.velocity(this->read<glm::dvec2>());
+            node->body.angular_velocity(this->read<double>());
+            break;
+        }
+        case NodeType::hitbox: {
+            node->hitbox.trigger_id(this->read<uint64_t>());
+            node->hitbox.group(this->read<uint64_t>());
+            node->hitbox.mask(this->read<uint64_t>());
+            node->hitbox.collision_mask(this->read<uint64_t>());
+            node->hitbox.sensor(this->read<uint8_t>());
+            node->hitbox.elasticity(this->read<double>());
+            node->hitbox.friction(this->read<double>());
+            node->hitbox.surface_velocity(this->read<glm::dvec2>());
+            break;
+        }
+        case NodeType::text: {
+            const auto representation_size =
+                this->read<UnicodeRepresentationSize>();
+            KAACORE_CHECK(
+                representation_size == UnicodeRepresentationSize::ucs1 or
+                    representation_size == UnicodeRepresentationSize::ucs2 or
+                    representation_size == UnicodeRepresentationSize::ucs4,
+                "Invalid text representation in nodes snapshot."
+            );
+            const auto content_bytes = this->read_vector<uint8_t>();
+            node->text.content(UnicodeView{
+                content_bytes.data(),
+                content_bytes.size() / size_t(representation_size),
+                representation_size
+            });
+            node->text.font_size(this->read<double>());
+            node->text.line_width(this->read<double>());
+            node->text.interline_spacing(this->read<double>());
+            node->text.first_line_indent(this->read<double>());
+            break;
+        }
+        case NodeType::particle_emitter: {
+            auto& emitter = node->particle_emitter;
+            emitter.emitting(this->read<uint8_t>());
+            emitter.emission_rate(this->read<double>());
+            emitter.max_particles(this->read<uint32_t>());
+            emitter.particle_lifetime(Duration(this->read<double>()));
+            emitter.particle_lifetime_spread(Duration(this->read<double>()));
+            emitter.initial_velocity(this->read<glm::dvec2>());
+            emitter.velocity_spread(this->read<glm::dvec2>());
+            emitter.gravity(this->read<glm::dvec2>());
+            emitter.start_color(this->read<glm::dvec4>());
+            emitter.end_color(this->read<glm::dvec4>());
+            emitter.start_size(this->read<double>());
+            emitter.end_size(this->read<double>());
+            const auto frames_count = this->read<uint32_t>();
+            // every frame takes at least its texture index
+            this->_require(size_t(frames_count) * sizeof(uint32_t));
+            std::vector<Sprite> sprite_frames(frames_count);
+            for (auto& frame : sprite_frames) {
+                frame = this->_read_sprite();
+            }
+            emitter.sprite_frames(sprite_frames);
+            break;
+        }
+        case NodeType::tilemap: {
+            auto& tilemap = node->tilemap;
+            tilemap.tile_size(this->read<glm::dvec2>());
+            tilemap.chunk_size(this->read<uint32_t>());
+            tilemap.atlas(this->_read_sprite());
+            const auto chunks_count = this->read<uint32_t>();
+            for (uint32_t i = 0; i < chunks_count; i++) {
+                const auto chunk_position = this->read<glm::ivec2>();
+                tilemap.chunk_tiles(
+                    chunk_position, this->read_vector<TileId>()
+                );
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+std::vector<uint8_t>
+serialize_nodes(Node* const root)
+{
+    KAACORE_CHECK(root != nullptr, "Cannot serialize empty node.");
+    NodesSnapshotWriter writer;
+    writer.write_nodes(root);
+    return std::move(writer.buffer);
+}
+
+NodeOwnerPtr
+deserialize_nodes(const uint8_t* data, const size_t size)
+{
+    NodesSnapshotReader reader{data, size};
+    return reader.read_nodes();
+}
+
+void
+save_nodes(Node* const root, const std::string& path)
+{
+    KAACORE_LOG_INFO("Saving nodes snapshot: {}", path);
+    const auto snapshot = serialize_nodes(root);
+    std::ofstream f(path, std::ofstream::binary);
+    if (f.fail()) {
+        throw std::ios_base::failure("Failed to open file: " + path);
+    }
+    f.write(reinterpret_cast<const char*>(snapshot.data()), snapshot.size());
+    if (f.fail()) {
+        throw std::ios_base::failure("Failed to write file: " + path);
+    }
+}
+
+NodeOwnerPtr
+load_nodes(const std::string& path)
+{
+    MappedFile file{path};
+    return deserialize_nodes(file.data(), file.size());
+}
+
+} // namespace kaacore
@@ -1,16 +1,99 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
 #include <tuple>
 
 #include <glm/glm.hpp>
 
+#include "kaacore/camera.h"
+#include "kaacore/engine.h"
 #include "kaacore/exceptions.h"
 #include "kaacore/geometry.h"
+#include "kaacore/renderer.h"
 
 #include "kaacore/shapes.h"
 
 namespace kaacore {
 
-constexpr int circle_shape_generated_points_count = 24;
+// unit circle points are shared by all shapes with the same
+// segments count, so sin/cos are computed once per segments count,
+// tables are never freed, so once built they are read without locking
+inline const std::vector<glm::dvec2>&
+unit_circle_points(const uint32_t segments_count)
+{
+    static std::array<
+        std::atomic<const std::vector<glm::dvec2>*>,
+        max_circle_segments_count + 1>
+        tables;
+    static std::array<
+        std::unique_ptr<const std::vector<glm::dvec2>>,
+        max_circle_segments_count + 1>
+        owned_tables;
+    static std::mutex build_mutex;
+
+    KAACORE_ASSERT(
+        segments_count <= max_circle_segments_count,
+        "Invalid circle segments count: {}.", segments_count
+    );
+    auto& table = tables[segments_count];
+    if (const auto points = table.load(std::memory_order_acquire)) {
+        return *points;
+    }
+
+    std::lock_guard lock{build_mutex};
+    if (const auto points = table.load(std::memory_order_relaxed)) {
+        return *points;
+    }
+    auto points = std::make_unique<std::vector<glm::dvec2>>();
+    points->reserve(segments_count);
+    for (int i = segments_count - 1; i >= 0; i--) {
+        double t = (2 * M_PI / segments_count) * i;
+        points->push_back(glm::dvec2{std::sin(t), std::cos(t)});
+    }
+    table.store(points.get(), std::memory_order_release);
+    owned_tables[segments_count] = std::move(points);
+    return *owned_tables[segments_count];
+}
+
+// camera scale is in virtual resolution units, which are
+// then stretched to the window, so both are needed to know
+// how many pixels a world unit takes
+inline double
+camera_scale_factor(const Camera& camera)
+{
+    const glm::dvec2 scale = glm::abs(camera.scale());
+    const auto engine = get_engine();
+    const glm::dvec2 view_scale = glm::dvec2(engine->renderer->view_size) /
+                                  glm::dvec2(engine->virtual_resolution());
+    return std::max(scale.x * view_scale.x, scale.y * view_scale.y);
+}
+
+uint32_t
+circle_segments_count(const double radius, const double max_radial_error)
+{
+    KAACORE_CHECK(
+        max_radial_error > 0., "Max radial error must be positive."
+    );
+    if (radius <= max_radial_error) {
+        return min_circle_segments_count;
+    }
+    // edge of regular polygon with n sides deviates from
+    // circumscribed circle by r * (1 - cos(pi / n))
+    const double segments_count =
+        std::ceil(M_PI / std::acos(1. - max_radial_error / radius));
+    return std::clamp<double>(
+        segments_count, min_circle_segments_count, max_circle_segments_count
+    );
+}
+
+double
+circle_radial_error(const double radius, const uint32_t segments_count)
+{
+    return radius * (1. - std::cos(M_PI / segments_count));
+}
 
 Shape::Shape(
     const ShapeType type, const std::vector<glm::dvec2>& points,
@@ -42,12 +125,15 @@ Shape::Shape(
 };
 
 bool
-Shape::operator==(const Shape& other)
+Shape::operator==(const Shape& other) const
 {
     return (
-        this->type == other.type and this->points == other.points and
-        this->radius == other.radius and this->indices == other.indices and
-        this->vertices == other.vertices
+        this->type == other.type and this->radius == other.radius and
+        this->vertices.size() == other.vertices.size() and
+        this->points == other.points and this->indices == other.indices and
+        this->vertices == other.vertices and
+        this->bounding_points == other.bounding_points and
+        this->geometry == other.geometry
     );
 }
 
@@ -57,6 +143,24 @@ Shape::bounding_box() const
     return this->vertices_bbox;
 }
 
+const std::vector<VertexIndex>&
+Shape::get_indices() const
+{
+    if (this->geometry) {
+        return this->geometry->indices;
+    }
+    return this->indices;
+}
+
+const std::vector<StandardVertexData>&
+Shape::get_vertices() const
+{
+    if (this->geometry) {
+        return this->geometry->vertices;
+    }
+    return this->vertices;
+}
+
 Shape
 Shape::Segment(const glm::dvec2 a, const glm::dvec2 b)
 {
@@ -90,8 +194,15 @@ Shape::Segment(const glm::dvec2 a, const glm::dvec2 b)
 }
 
 Shape
-Shape::Circle(const double radius, const glm::dvec2 center)
+Shape::Circle(
+    const double radius, const glm::dvec2 center, const uint32_t segments_count
+)
 {
+    KAACORE_CHECK(
+        segments_count >= 3 and segments_count <= max_circle_segments_count,
+        "Circle segments count must be in range [3, {}].",
+        max_circle_segments_count
+    );
     const std::vector<glm::dvec2> points = {center};
 
     const std::vector<StandardVertexData> vertices = {
@@ -111,26 +222,107 @@ Shape::Circle(const double radius, const glm::dvec2 center)
 
     const std::vector<VertexIndex> indices = {0, 2, 1, 0, 3, 2};
 
+    const auto& circle_points = unit_circle_points(segments_count);
     std::vector<glm::dvec2> bounding_points;
-    bounding_points.reserve(circle_shape_generated_points_count);
-    for (int i = circle_shape_generated_points_count - 1; i >= 0; i--) {
-        double t = (2 * M_PI / circle_shape_generated_points_count) * i;
-        bounding_points.push_back(glm::dvec2{
-            center.x + radius * std::sin(t), center.y + radius * std::cos(t)
-        });
+    bounding_points.reserve(segments_count);
+    for (const auto& circle_point : circle_points) {
+        bounding_points.push_back(center + radius * circle_point);
     }
 
     return Shape(
-        ShapeType::circle, points, radius, indices, vertices, bounding_points
+        ShapeType::circle, points, radius, indices, vertices,
+        BoundingBox<double>{
+            center.x - radius, center.y - radius, center.x + radius,
+            center.y + radius
+        },
+        bounding_points
     );
 }
 
+Shape
+Shape::Circle(
+    const double radius, const glm::dvec2 center, const Camera& camera
+)
+{
+    return Shape::Circle(
+        radius, center,
+        circle_segments_count(radius * camera_scale_factor(camera))
+    );
+}
+
+Shape
+Shape::Circle(const double radius, const glm::dvec2 center)
+{
+    return Shape::Circle(radius, center, default_circle_segments_count);
+}
+
 Shape
 Shape::Circle(const double radius)
 {
     return Shape::Circle(radius, glm::dvec2(0., 0.));
 }
 
+Shape
+Shape::AdaptiveCircle(
+    const double radius, const glm::dvec2 center, const double max_radial_error
+)
+{
+    return Shape::Circle(
+        radius, center, circle_segments_count(radius, max_radial_error)
+    );
+}
+
+Shape
+Shape::Ellipse(
+    const glm::dvec2 radii, const glm::dvec2 center,
+    const uint32_t segments_count
+)
+{
+    KAACORE_CHECK(
+        radii.x > 0. and radii.y > 0., "Ellipse radii must be positive."
+    );
+    KAACORE_CHECK(
+        segments_count >= 3 and segments_count <= max_circle_segments_count,
+        "Ellipse segments count must be in range [3, {}].",
+        max_circle_segments_count
+    );
+    const auto& circle_points = unit_circle_points(segments_count);
+    std::vector<glm::dvec2> points;
+    points.reserve(segments_count);
+    for (const auto& circle_point : circle_points) {
+        points.push_back(center + radii * circle_point);
+    }
+    return Shape::Polygon(points);
+}
+
+Shape
+Shape::Ellipse(
+    const glm::dvec2 radii, const glm::dvec2 center, const Camera& camera
+)
+{
+    // larger radius has the largest error for given segments count
+    return Shape::Ellipse(
+        radii, center,
+        circle_segments_count(
+            std::max(radii.x, radii.y) * camera_scale_factor(camera)
+        )
+    );
+}
+
+Shape
+Shape::Ellipse(const glm::dvec2 radii, const glm::dvec2 center)
+{
+    return Shape::Ellipse(
+        radii, center, circle_segments_count(std::max(radii.x, radii.y))
+    );
+}
+
+Shape
+Shape::Ellipse(const glm::dvec2 radii)
+{
+    return Shape::Ellipse(radii, glm::dvec2(0., 0.));
+}
+
 Shape
 Shape::Box(const glm::dvec2 size)
 {
@@ -247,6 +439,34 @@ Shape::Freeform(
     );
 }
 
+Shape
+Shape::Freeform(const GeometryBufferHandle& geometry)
+{
+    KAACORE_CHECK(geometry != nullptr, "Invalid geometry buffer.");
+    std::vector<glm::dvec2> vertices_points;
+    vertices_points.reserve(geometry->vertices.size());
+    for (const auto& vt : geometry->vertices) {
+        vertices_points.push_back({vt.xyz.x, vt.xyz.y});
+    }
+    return Shape::Freeform(
+        geometry, BoundingBox<double>::from_points(vertices_points)
+    );
+}
+
+Shape
+Shape::Freeform(
+    const GeometryBufferHandle& geometry,
+    const BoundingBox<double> bounding_box
+)
+{
+    // bounding box is not updated when geometry is modified,
+    // it has to cover all of the future vertices positions
+    KAACORE_CHECK(geometry != nullptr, "Invalid geometry buffer.");
+    auto shape = Shape::Freeform({}, {}, bounding_box);
+    shape.geometry = geometry;
+    return shape;
+}
+
 Shape
 Shape::transform(const Transformation& transformation) const
 {
@@ -266,7 +486,9 @@ Shape::transform(const Transformation& transformation) const
         radius *= scale_ratio.x;
     }
 
-    auto vertices = this->vertices;
+    // shapes referencing geometry buffer are transformed into
+    // regular freeform shapes with their own copy of vertices
+    auto vertices = this->get_vertices();
     for (auto& vt : vertices) {
         auto tmp_pt = glm::dvec2(vt.xyz.x, vt.xyz.y);
         tmp_pt |= transformation;
@@ -285,7 +507,8 @@ Shape::transform(const Transformation& transformation) const
     );
 
     return Shape(
-        this->type, points, radius, this->indices, vertices, new_bounding_points
+        this->type, points, radius, this->get_indices(), vertices,
+        new_bounding_points
     );
 }
 
@@ -295,4 +518,83 @@ Shape::contains_point(const glm::dvec2 point) const
     return check_point_in_polygon(this->bounding_points, point);
 }
 
+struct InternedShapesRegistry {
+    struct Entry {
+        // shape stays alive until its entry is erased by deleter,
+        // so it can be compared without locking the handle
+        const Shape* shape;
+        std::weak_ptr<const Shape> handle;
+    };
+
+    std::mutex mutex;
+    std::unordered_multimap<size_t, Entry> shapes;
+};
+
+inline InternedShapesRegistry&
+interned_shapes_registry()
+{
+    // never destroyed, handles may outlive static objects
+    static auto registry = new InternedShapesRegistry;
+    return *registry;
+}
+
+ShapeHandle
+intern_shape(const Shape& shape)
+{
+    if (not shape) {
+        return empty_shape_handle();
+    }
+
+    const size_t shape_hash = std::hash<Shape>{}(shape);
+    auto& registry = interned_shapes_registry();
+    std::lock_guard lock{registry.mutex};
+    auto [it, end] = registry.shapes.equal_range(shape_hash);
+    for (; it != end; it++) {
+        if (*it->second.shape == shape) {
+            // handle is locked only when it's returned, temporary owner
+            // released here could run deleter with registry locked
+            if (auto interned_shape = it->second.handle.lock()) {
+                return interned_shape;
+            }
+        }
+    }
+
+    ShapeHandle interned_shape{
+        new Shape(shape), [shape_hash](const Shape* released_shape) {
+            {
+                auto& registry = interned_shapes_registry();
+                std::lock_guard lock{registry.mutex};
+                auto [it, end] = registry.shapes.equal_range(shape_hash);
+                for (; it != end; it++) {
+                    if (it->second.shape == released_shape) {
+                        registry.shapes.erase(it);
+                        break;
+                    }
+                }
+            }
+            delete released_shape;
+        }
+    };
+    registry.shapes.emplace(
+        shape_hash,
+        InternedShapesRegistry::Entry{interned_shape.get(), interned_shape}
+    );
+    return interned_shape;
+}
+
+const ShapeHandle&
+empty_shape_handle()
+{
+    static const auto empty_shape = new ShapeHandle{std::make_shared<Shape>()};
+    return *empty_shape;
+}
+
+size_t
+interned_shapes_count()
+{
+    auto& registry = interned_shapes_registry();
+    std::lock_guard lock{registry.mutex};
+    return registry.shapes.size();
+}
+
 } // namespace kaacore
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <optional>
+#include <type_traits>
 #include <vector>
 
 #include <chipmunk/chipmunk.h>
@@ -13,6 +17,10 @@
 namespace kaacore {
 
 constexpr int circle_shape_generated_points_count = 24;
+// nearest query searches growing area, starting with this radius
+constexpr double nearest_query_initial_radius = 32.;
+// smaller batches are cheap to insert incrementally
+constexpr size_t bb_tree_optimize_min_batch_size = 256;
 
 inline cpBB
 convert_bounding_box(const BoundingBox<double>& bounding_box)
@@ -23,6 +31,85 @@ convert_bounding_box(const BoundingBox<double>& bounding_box)
     );
 }
 
+inline double
+cross_product(const glm::dvec2 a, const glm::dvec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+inline std::optional<double>
+find_segment_polygon_entry(
+    const std::vector<glm::dvec2>& polygon_points, const glm::dvec2 start,
+    const glm::dvec2 end
+)
+{
+    // returns fraction of the segment at which it enters the polygon
+    if (check_point_in_polygon(polygon_points, start)) {
+        return 0.;
+    }
+    const glm::dvec2 direction = end - start;
+    const auto points_count = polygon_points.size();
+    std::optional<double> entry;
+    for (size_t i = 0; i < points_count; i++) {
+        const auto& edge_start = polygon_points[i];
+        const auto edge = polygon_points[(i + 1) % points_count] - edge_start;
+        const double denominator = cross_product(direction, edge);
+        if (denominator == 0.) {
+            // parallel, collinear overlap is reported by adjacent edges
+            continue;
+        }
+        const glm::dvec2 offset = edge_start - start;
+        const double t = cross_product(offset, edge) / denominator;
+        const double u = cross_product(offset, direction) / denominator;
+        if (t >= 0. and t <= 1. and u >= 0. and u <= 1. and
+            (not entry or t < *entry)) {
+            entry = t;
+        }
+    }
+    return entry;
+}
+
+inline glm::dvec2
+find_closest_segment_point(
+    const glm::dvec2 segment_start, const glm::dvec2 segment_end,
+    const glm::dvec2 point
+)
+{
+    const glm::dvec2 segment = segment_end - segment_start;
+    const double length_squared = glm::dot(segment, segment);
+    if (length_squared == 0.) {
+        return segment_start;
+    }
+    const double t = glm::clamp(
+        glm::dot(point - segment_start, segment) / length_squared, 0., 1.
+    );
+    return segment_start + t * segment;
+}
+
+inline glm::dvec2
+find_closest_polygon_point(
+    const std::vector<glm::dvec2>& polygon_points, const glm::dvec2 point
+)
+{
+    if (check_point_in_polygon(polygon_points, point)) {
+        return point;
+    }
+    const auto points_count = polygon_points.size();
+    glm::dvec2 closest = polygon_points[0];
+    double closest_distance = glm::distance(point, closest);
+    for (size_t i = 0; i < points_count; i++) {
+        const auto candidate = find_closest_segment_point(
+            polygon_points[i], polygon_points[(i + 1) % points_count], point
+        );
+        const double distance = glm::distance(point, candidate);
+        if (distance < closest_distance) {
+            closest = candidate;
+            closest_distance = distance;
+        }
+    }
+    return closest;
+}
+
 cpBB
 _node_wrapper_bbfunc(void* node_wrapper_obj)
 {
@@ -41,6 +128,37 @@ container_node(const NodeSpatialData* spatial_data)
     return container_of(spatial_data, &Node::_spatial_data);
 }
 
+BoundingBox<double>
+NodeSpatialData::calculate_bounding_box(
+    std::vector<glm::dvec2>& bounding_points
+) const
+{
+    Node* node = container_node(this);
+    const auto node_transformation = node->absolute_transformation();
+    const auto& shape = *node->_shape;
+    if (not shape) {
+        bounding_points.clear();
+        return BoundingBox<double>::single_point(
+            node->_position | node_transformation
+        );
+    }
+
+    const auto shape_transformation =
+        Transformation::translate(calculate_realignment_vector(
+            node->_origin_alignment, shape.vertices_bbox
+        )) |
+        node_transformation;
+    bounding_points.resize(shape.bounding_points.size());
+    std::transform(
+        shape.bounding_points.begin(), shape.bounding_points.end(),
+        bounding_points.begin(),
+        [&shape_transformation](glm::dvec2 pt) -> glm::dvec2 {
+            return pt | shape_transformation;
+        }
+    );
+    return BoundingBox<double>::from_points(bounding_points);
+}
+
 void
 NodeSpatialData::refresh()
 {
@@ -49,32 +167,8 @@ NodeSpatialData::refresh()
         KAACORE_LOG_TRACE(
             "Trigerred refresh of NodeSpatialData of node: {}", fmt::ptr(node)
         );
-        const auto node_transformation = node->absolute_transformation();
-        const auto shape = node->_shape;
-        if (shape) {
-            const auto shape_transformation =
-                Transformation::translate(calculate_realignment_vector(
-                    node->_origin_alignment, shape.vertices_bbox
-                )) |
-                node_transformation;
-            this->bounding_points_transformed.resize(shape.bounding_points.size(
-            ));
-            std::transform(
-                shape.bounding_points.begin(), shape.bounding_points.end(),
-                this->bounding_points_transformed.begin(),
-                [&shape_transformation](glm::dvec2 pt) -> glm::dvec2 {
-                    return pt | shape_transformation;
-                }
-            );
-            this->bounding_box = BoundingBox<double>::from_points(
-                this->bounding_points_transformed
-            );
-        } else {
-            this->bounding_points_transformed.clear();
-            this->bounding_box = BoundingBox<double>::single_point(
-                node->_position | node_transformation
-            );
-        }
+        this->bounding_box =
+            this->calculate_bounding_box(this->bounding_points_transformed);
         KAACORE_LOG_TRACE(
             " -> Resulting bbox x:({:.2f}, {:.2f}) y:({:.2f}, {:.2f})",
             this->bounding_box.min_x, this->bounding_box.max_x,
@@ -91,7 +185,9 @@ NodeSpatialData::contains_point(const glm::dvec2 point) const
     return check_point_in_polygon(this->bounding_points_transformed, point);
 }
 
-SpatialIndex::SpatialIndex() : _index_counter(0)
+SpatialIndex::SpatialIndex()
+    : _backend(SpatialIndexBackend::bb_tree), _index_counter(0),
+      _has_stale_bounds(false)
 {
     this->_cp_index = cpBBTreeNew(_node_wrapper_bbfunc, nullptr);
 }
@@ -101,6 +197,42 @@ SpatialIndex::~SpatialIndex()
     cpSpatialIndexFree(this->_cp_index);
 }
 
+SpatialIndexBackend
+SpatialIndex::backend() const
+{
+    return this->_backend;
+}
+
+void
+SpatialIndex::use_bb_tree()
+{
+    this->_replace_cp_index(
+        cpBBTreeNew(_node_wrapper_bbfunc, nullptr), SpatialIndexBackend::bb_tree
+    );
+}
+
+void
+SpatialIndex::use_spatial_hash(
+    const double cell_size, const uint32_t cells_count
+)
+{
+    KAACORE_CHECK(cell_size > 0., "Cell size must be greater than zero.");
+    KAACORE_CHECK(cells_count > 0, "Cells count must be greater than zero.");
+    this->_replace_cp_index(
+        cpSpaceHashNew(cell_size, cells_count, _node_wrapper_bbfunc, nullptr),
+        SpatialIndexBackend::spatial_hash
+    );
+}
+
+void
+SpatialIndex::use_sweep_and_prune()
+{
+    this->_replace_cp_index(
+        cpSweep1DNew(_node_wrapper_bbfunc, nullptr),
+        SpatialIndexBackend::sweep_and_prune
+    );
+}
+
 void
 SpatialIndex::start_tracking(Node* node)
 {
@@ -109,6 +241,30 @@ SpatialIndex::start_tracking(Node* node)
     }
 }
 
+void
+SpatialIndex::start_tracking(const std::vector<Node*>& nodes)
+{
+    const size_t indexed_count = cpSpatialIndexCount(this->_cp_index);
+    size_t added_count = 0;
+    for (Node* node : nodes) {
+        if (node->_indexable) {
+            this->_add_to_cp_index(node);
+            added_count++;
+        }
+    }
+
+    // incremental inserts of a large batch leave the tree poorly
+    // balanced, rebuilding it once keeps queries fast
+    if (this->_backend == SpatialIndexBackend::bb_tree and
+        added_count >= bb_tree_optimize_min_batch_size and
+        added_count >= indexed_count) {
+        KAACORE_LOG_DEBUG(
+            "Optimizing spatial index after adding {} nodes.", added_count
+        );
+        cpBBTreeOptimize(this->_cp_index);
+    }
+}
+
 void
 SpatialIndex::stop_tracking(Node* node)
 {
@@ -135,63 +291,316 @@ SpatialIndex::update_single(Node* node)
     }
 }
 
+void
+SpatialIndex::flush_updates()
+{
+    if (not this->_has_stale_bounds) {
+        return;
+    }
+    KAACORE_ASSERT(
+        this->_backend == SpatialIndexBackend::sweep_and_prune,
+        "Only sweep and prune backend defers updates."
+    );
+    // reinserting all objects is linear, unlike removing
+    // and inserting every updated one (cpSweep1D removal is linear)
+    this->_replace_cp_index(
+        cpSweep1DNew(_node_wrapper_bbfunc, nullptr),
+        SpatialIndexBackend::sweep_and_prune
+    );
+}
+
+template<typename Visitor>
+struct _SpatialIndexQueryContext {
+    const BoundingBox<double>& bbox;
+    Visitor& visitor;
+    bool is_stopped = false;
+};
+
+template<typename Visitor>
+cpCollisionID
+_cp_spatial_index_query(
+    void* obj, void* subtree_obj, cpCollisionID cid, void* data
+)
+{
+    auto context = reinterpret_cast<_SpatialIndexQueryContext<Visitor>*>(data);
+    auto wrapper = reinterpret_cast<NodeSpatialData*>(subtree_obj);
+    // chipmunk's query can't be interrupted, remaining
+    // candidates are skipped instead
+    if (context->is_stopped) {
+        return cid;
+    }
+    // spatial hash reports everything from overlapping cells and
+    // sweep checks only x axis, so bounding box is checked here
+    // to keep results the same for all backends
+    if (wrapper->bounding_box.intersects(context->bbox)) {
+        context->is_stopped = not context->visitor(wrapper);
+    }
+    return cid;
+}
+
+// visitor is passed by its own type, wrapping it in std::function
+// could allocate on every query
+template<typename Visitor>
+void
+SpatialIndex::_query_wrappers(
+    const BoundingBox<double>& bbox, Visitor&& visitor
+)
+{
+    _SpatialIndexQueryContext<std::remove_reference_t<Visitor>> context{
+        bbox, visitor
+    };
+    auto cp_bbox = convert_bounding_box(bbox);
+    cpSpatialIndexQuery(
+        this->_cp_index, nullptr, cp_bbox,
+        _cp_spatial_index_query<std::remove_reference_t<Visitor>>,
+        reinterpret_cast<void*>(&context)
+    );
+}
+
 std::vector<NodePtr>
 SpatialIndex::query_bounding_box(
     const BoundingBox<double>& bbox, bool include_shapeless
 )
 {
-    auto wrapper_results = this->_query_wrappers(bbox);
     std::vector<NodePtr> results;
-    results.reserve(wrapper_results.size());
-    for (auto wrapper : wrapper_results) {
-        if (include_shapeless or
-            wrapper->bounding_points_transformed.size() > 1) {
-            results.push_back(container_node(wrapper));
-        }
-    }
-
+    this->query_bounding_box(bbox, results, include_shapeless);
     return results;
 }
 
 std::vector<NodePtr>
 SpatialIndex::query_point(const glm::dvec2 point)
 {
-    auto wrapper_results =
-        this->_query_wrappers(BoundingBox{point.x, point.y, point.x, point.y});
     std::vector<NodePtr> results;
-    for (auto wrapper : wrapper_results) {
-        if (wrapper->bounding_points_transformed.size() > 1 and
-            wrapper->contains_point(point)) {
-            results.push_back(container_node(wrapper));
+    this->query_point(point, results);
+    return results;
+}
+
+void
+SpatialIndex::query_bounding_box(
+    const BoundingBox<double>& bbox, std::vector<NodePtr>& results,
+    bool include_shapeless
+)
+{
+    results.clear();
+    this->query_bounding_box(
+        bbox,
+        [&results](NodePtr node) {
+            results.push_back(node);
+            return true;
+        },
+        include_shapeless
+    );
+}
+
+void
+SpatialIndex::query_bounding_box(
+    const BoundingBox<double>& bbox, const SpatialQueryCallback& callback,
+    bool include_shapeless
+)
+{
+    this->_query_wrappers(
+        bbox,
+        [&callback, include_shapeless](NodeSpatialData* wrapper) {
+            if (include_shapeless or
+                wrapper->bounding_points_transformed.size() > 1) {
+                return callback(container_node(wrapper));
+            }
+            return true;
+        }
+    );
+}
+
+void
+SpatialIndex::query_point(
+    const glm::dvec2 point, std::vector<NodePtr>& results
+)
+{
+    results.clear();
+    this->query_point(point, [&results](NodePtr node) {
+        results.push_back(node);
+        return true;
+    });
+}
+
+void
+SpatialIndex::query_point(
+    const glm::dvec2 point, const SpatialQueryCallback& callback
+)
+{
+    this->_query_wrappers(
+        BoundingBox{point.x, point.y, point.x, point.y},
+        [&callback, point](NodeSpatialData* wrapper) {
+            if (wrapper->bounding_points_transformed.size() > 1 and
+                wrapper->contains_point(point)) {
+                return callback(container_node(wrapper));
+            }
+            return true;
+        }
+    );
+}
+
+struct _SpatialIndexSegmentQueryContext {
+    const glm::dvec2 start;
+    const glm::dvec2 end;
+    std::vector<SpatialQueryResult>& results;
+};
+
+cpFloat
+_cp_spatial_index_segment_query(void* obj, void* subtree_obj, void* data)
+{
+    auto context = reinterpret_cast<_SpatialIndexSegmentQueryContext*>(data);
+    auto wrapper = reinterpret_cast<NodeSpatialData*>(subtree_obj);
+    if (wrapper->bounding_points_transformed.size() > 1) {
+        const auto entry = find_segment_polygon_entry(
+            wrapper->bounding_points_transformed, context->start, context->end
+        );
+        if (entry) {
+            const glm::dvec2 segment = context->end - context->start;
+            context->results.push_back(
+                {container_node(wrapper), context->start + *entry * segment,
+                 *entry * glm::length(segment)}
+            );
         }
     }
+    // keep looking through the whole segment
+    return 1.;
+}
 
+std::vector<SpatialQueryResult>
+SpatialIndex::query_segment(const glm::dvec2 start, const glm::dvec2 end)
+{
+    std::vector<SpatialQueryResult> results;
+    _SpatialIndexSegmentQueryContext context{start, end, results};
+    cpSpatialIndexSegmentQuery(
+        this->_cp_index, nullptr, cpv(start.x, start.y), cpv(end.x, end.y), 1.,
+        _cp_spatial_index_segment_query, reinterpret_cast<void*>(&context)
+    );
+    this->_sort_query_results(results);
     return results;
 }
 
-cpCollisionID
-_cp_spatial_index_query(
-    void* obj, void* subtree_obj, cpCollisionID cid, void* data
+std::vector<SpatialQueryResult>
+SpatialIndex::query_ray(
+    const glm::dvec2 origin, const glm::dvec2 direction,
+    const double max_distance
 )
 {
-    auto wrapper_results =
-        reinterpret_cast<std::vector<NodeSpatialData*>*>(obj);
-    auto wrapper = reinterpret_cast<NodeSpatialData*>(subtree_obj);
-    wrapper_results->push_back(wrapper);
-    return cid;
+    KAACORE_CHECK(
+        direction != glm::dvec2(0.), "Ray direction can't be zero vector."
+    );
+    KAACORE_CHECK(
+        std::isfinite(max_distance) and max_distance >= 0.,
+        "Ray distance must be finite and non-negative."
+    );
+    return this->query_segment(
+        origin, origin + glm::normalize(direction) * max_distance
+    );
 }
 
-std::vector<NodeSpatialData*>
-SpatialIndex::_query_wrappers(const BoundingBox<double>& bbox)
+std::vector<SpatialQueryResult>
+SpatialIndex::query_nearest(
+    const glm::dvec2 point, const size_t count, const double max_distance,
+    bool include_shapeless
+)
 {
-    std::vector<NodeSpatialData*> wrapper_results;
-    auto cp_bbox = convert_bounding_box(bbox);
-    cpSpatialIndexQuery(
-        this->_cp_index, reinterpret_cast<void*>(&wrapper_results), cp_bbox,
-        _cp_spatial_index_query, nullptr
+    KAACORE_CHECK(max_distance >= 0., "Distance can't be negative.");
+    std::vector<SpatialQueryResult> results;
+    if (count == 0) {
+        return results;
+    }
+
+    // Every node within radius has its bounding box within radius
+    // as well, so bounding box query finds all of them. Once there
+    // are enough of them, the closest ones are known for sure.
+    const size_t indexed_count = cpSpatialIndexCount(this->_cp_index);
+    double radius = std::min(nearest_query_initial_radius, max_distance);
+    while (true) {
+        results.clear();
+        size_t candidates_count = 0;
+        this->_query_wrappers(
+            BoundingBox<double>{
+                point.x - radius, point.y - radius, point.x + radius,
+                point.y + radius
+            },
+            [&](NodeSpatialData* wrapper) {
+                candidates_count++;
+                glm::dvec2 closest;
+                if (wrapper->bounding_points_transformed.size() > 1) {
+                    closest = find_closest_polygon_point(
+                        wrapper->bounding_points_transformed, point
+                    );
+                } else if (include_shapeless) {
+                    closest = {
+                        wrapper->bounding_box.min_x, wrapper->bounding_box.min_y
+                    };
+                } else {
+                    return true;
+                }
+                const double distance = glm::distance(point, closest);
+                if (distance <= radius) {
+                    results.push_back(
+                        {container_node(wrapper), closest, distance}
+                    );
+                }
+                return true;
+            }
+        );
+        if (results.size() >= count or radius >= max_distance or
+            candidates_count == indexed_count) {
+            break;
+        }
+        radius = std::min(radius * 2., max_distance);
+    }
+
+    this->_sort_query_results(results);
+    if (results.size() > count) {
+        results.erase(results.begin() + count, results.end());
+    }
+    return results;
+}
+
+void
+SpatialIndex::_sort_query_results(std::vector<SpatialQueryResult>& results)
+{
+    // index uid breaks ties, so the order is deterministic
+    std::sort(
+        results.begin(), results.end(),
+        [](const SpatialQueryResult& a, const SpatialQueryResult& b) {
+            if (a.distance != b.distance) {
+                return a.distance < b.distance;
+            }
+            return a.node->_spatial_data.index_uid <
+                   b.node->_spatial_data.index_uid;
+        }
     );
+}
 
-    return wrapper_results;
+void
+_cp_spatial_index_reinsert(void* obj, void* data)
+{
+    auto wrapper = reinterpret_cast<NodeSpatialData*>(obj);
+    auto cp_index = reinterpret_cast<cpSpatialIndex*>(data);
+    cpSpatialIndexInsert(cp_index, wrapper, wrapper->index_uid);
+}
+
+void
+SpatialIndex::_replace_cp_index(
+    cpSpatialIndex* cp_index, const SpatialIndexBackend backend
+)
+{
+    KAACORE_LOG_DEBUG(
+        "Replacing spatial index backend ({} objects).",
+        cpSpatialIndexCount(this->_cp_index)
+    );
+    cpSpatialIndexEach(
+        this->_cp_index, _cp_spatial_index_reinsert,
+        reinterpret_cast<void*>(cp_index)
+    );
+    cpSpatialIndexFree(this->_cp_index);
+    this->_cp_index = cp_index;
+    this->_backend = backend;
+    // bounds of all objects were calculated again on insert
+    this->_has_stale_bounds = false;
 }
 
 void
@@ -215,6 +624,12 @@ SpatialIndex::_update_cp_index(Node* node)
     KAACORE_ASSERT(node->_spatial_data.is_indexed, "Node is not indexed.");
     KAACORE_LOG_DEBUG("Reindex node: {}", fmt::ptr(node));
 
+    if (this->_backend == SpatialIndexBackend::sweep_and_prune) {
+        // cpSweep1D caches bounds on insert and its ReindexObject is a
+        // no-op, node's bounds are refreshed in flush_updates
+        this->_has_stale_bounds = true;
+        return;
+    }
     cpSpatialIndexReindexObject(
         this->_cp_index, &node->_spatial_data, node->_spatial_data.index_uid
     );
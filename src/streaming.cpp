@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+#include "kaacore/exceptions.h"
+#include "kaacore/log.h"
+#include "kaacore/nodes.h"
+#include "kaacore/scenes.h"
+#include "kaacore/statistics.h"
+
+#include "kaacore/streaming.h"
+
+namespace kaacore {
+
+StreamingManager::StreamingManager(Scene* const scene) : _scene(scene) {}
+
+void
+StreamingManager::loader(StreamingLoadCallback callback)
+{
+    this->_loader = std::move(callback);
+}
+
+void
+StreamingManager::unloader(StreamingUnloadCallback callback)
+{
+    this->_unloader = std::move(callback);
+}
+
+glm::dvec2
+StreamingManager::cell_size() const
+{
+    return this->_cell_size;
+}
+
+void
+StreamingManager::cell_size(const glm::dvec2& size)
+{
+    KAACORE_CHECK(
+        size.x > 0. and size.y > 0., "Cell size must be greater than zero."
+    );
+    KAACORE_CHECK(
+        this->_cells.empty(), "Can't change cell size with cells loaded."
+    );
+    this->_cell_size = size;
+}
+
+double
+StreamingManager::activation_distance() const
+{
+    return this->_activation_distance;
+}
+
+double
+StreamingManager::deactivation_distance() const
+{
+    return this->_deactivation_distance;
+}
+
+void
+StreamingManager::distances(const double activation, const double deactivation)
+{
+    KAACORE_CHECK(activation >= 0., "Activation distance can't be negative.");
+    KAACORE_CHECK(
+        deactivation >= activation,
+        "Deactivation distance can't be lower than activation distance."
+    );
+    this->_activation_distance = activation;
+    this->_deactivation_distance = deactivation;
+}
+
+Duration
+StreamingManager::frame_budget() const
+{
+    return this->_frame_budget;
+}
+
+void
+StreamingManager::frame_budget(const Duration budget)
+{
+    KAACORE_CHECK(budget > 0.s, "Frame budget must be greater than zero.");
+    this->_frame_budget = budget;
+}
+
+std::vector<int16_t>
+StreamingManager::viewports() const
+{
+    return this->_viewports;
+}
+
+void
+StreamingManager::viewports(const std::vector<int16_t>& viewports)
+{
+    for (const auto z_index : viewports) {
+        KAACORE_CHECK(
+            z_index >= min_viewport_z_index and
+                z_index <= max_viewport_z_index,
+            "Invalid viewport z_index: {}.", z_index
+        );
+    }
+    this->_viewports = viewports;
+}
+
+glm::ivec2
+StreamingManager::cell_at(const glm::dvec2 position) const
+{
+    return glm::ivec2{glm::floor(position / this->_cell_size)};
+}
+
+BoundingBox<double>
+StreamingManager::cell_bounds(const glm::ivec2 cell) const
+{
+    const glm::dvec2 min = glm::dvec2(cell) * this->_cell_size;
+    const glm::dvec2 max = min + this->_cell_size;
+    return {min.x, min.y, max.x, max.y};
+}
+
+StreamingCellState
+StreamingManager::cell_state(const glm::ivec2 cell) const
+{
+    if (auto it = this->_cells.find(cell); it != this->_cells.end()) {
+        return it->second.state;
+    }
+    return StreamingCellState::inactive;
+}
+
+NodePtr
+StreamingManager::cell_root(const glm::ivec2 cell) const
+{
+    if (auto it = this->_cells.find(cell); it != this->_cells.end()) {
+        return this->_scene->resolve(it->second.root);
+    }
+    return nullptr;
+}
+
+std::vector<glm::ivec2>
+StreamingManager::active_cells() const
+{
+    std::vector<glm::ivec2> cells;
+    for (const auto& [cell, cell_data] : this->_cells) {
+        if (cell_data.state == StreamingCellState::active or
+            cell_data.state == StreamingCellState::unloading) {
+            cells.push_back(cell);
+        }
+    }
+    return cells;
+}
+
+size_t
+StreamingManager::pending_operations_count() const
+{
+    return std::count_if(
+        this->_cells.begin(), this->_cells.end(), [](const auto& entry) {
+            return entry.second.state == StreamingCellState::loading or
+                   entry.second.state == StreamingCellState::unloading;
+        }
+    );
+}
+
+void
+StreamingManager::process()
+{
+    if (not this->_loader) {
+        return;
+    }
+    StopwatchStatAutoPusher stopwatch{"streaming.process:time"};
+    CounterStatAutoPusher loads_counter{"streaming.loads:count"};
+    CounterStatAutoPusher unloads_counter{"streaming.unloads:count"};
+    const auto started_at = DefaultClock::now();
+
+    thread_local std::vector<glm::dvec2> focus_points;
+    focus_points.clear();
+    for (const auto z_index : this->_viewports) {
+        focus_points.push_back(
+            this->_scene->viewports[z_index].camera.position()
+        );
+    }
+    this->_update_cells_states(focus_points);
+
+    // (is_load, distance, x, y), unloads go first, farthest first,
+    // then loads, closest first, coordinates keep the order deterministic
+    thread_local std::vector<std::tuple<bool, double, int, int>> operations;
+    operations.clear();
+    for (const auto& [cell, cell_data] : this->_cells) {
+        const double distance = this->_cell_distance(cell, focus_points);
+        if (cell_data.state == StreamingCellState::loading) {
+            operations.emplace_back(true, distance, cell.x, cell.y);
+        } else if (cell_data.state == StreamingCellState::unloading) {
+            operations.emplace_back(false, -distance, cell.x, cell.y);
+        }
+    }
+    std::sort(operations.begin(), operations.end());
+
+    for (size_t i = 0; i < operations.size(); i++) {
+        if (i > 0 and DefaultClock::now() - started_at >= this->_frame_budget) {
+            KAACORE_LOG_TRACE(
+                "Streaming frame budget used up, {} operations left.",
+                operations.size() - i
+            );
+            break;
+        }
+        const auto& [is_load, distance, x, y] = operations[i];
+        const glm::ivec2 cell{x, y};
+        auto it = this->_cells.find(cell);
+        if (is_load) {
+            this->_load_cell(cell, it->second);
+            loads_counter += 1;
+        } else {
+            this->_unload_cell(cell, it->second);
+            this->_cells.erase(it);
+            unloads_counter += 1;
+        }
+    }
+}
+
+void
+StreamingManager::clear()
+{
+    for (auto& [cell, cell_data] : this->_cells) {
+        if (cell_data.state == StreamingCellState::active or
+            cell_data.state == StreamingCellState::unloading) {
+            this->_unload_cell(cell, cell_data);
+        }
+    }
+    this->_cells.clear();
+}
+
+void
+StreamingManager::_update_cells_states(
+    const std::vector<glm::dvec2>& focus_points
+)
+{
+    for (auto it = this->_cells.begin(); it != this->_cells.end();) {
+        auto& cell_data = it->second;
+        const double distance = this->_cell_distance(it->first, focus_points);
+        if (distance > this->_deactivation_distance) {
+            if (cell_data.state == StreamingCellState::loading) {
+                // never loaded, just forget it
+                it = this->_cells.erase(it);
+                continue;
+            }
+            cell_data.state = StreamingCellState::unloading;
+        } else if (distance <= this->_activation_distance and
+                   cell_data.state == StreamingCellState::unloading) {
+            cell_data.state = StreamingCellState::active;
+        }
+        ++it;
+    }
+
+    const glm::dvec2 reach = glm::dvec2{this->_activation_distance};
+    for (const auto& point : focus_points) {
+        const glm::ivec2 first_cell = this->cell_at(point - reach);
+        const glm::ivec2 last_cell = this->cell_at(point + reach);
+        for (int y = first_cell.y; y <= last_cell.y; y++) {
+            for (int x = first_cell.x; x <= last_cell.x; x++) {
+                const glm::ivec2 cell{x, y};
+                if (this->_cells.count(cell) == 0 and
+                    this->_cell_distance(cell, focus_points) <=
+                        this->_activation_distance) {
+                    this->_cells[cell].state = StreamingCellState::loading;
+                }
+            }
+        }
+    }
+}
+
+double
+StreamingManager::_cell_distance(
+    const glm::ivec2 cell, const std::vector<glm::dvec2>& focus_points
+) const
+{
+    const auto bounds = this->cell_bounds(cell);
+    double distance = std::numeric_limits<double>::infinity();
+    for (const auto& point : focus_points) {
+        const glm::dvec2 closest = glm::clamp(
+            point, glm::dvec2{bounds.min_x, bounds.min_y},
+            glm::dvec2{bounds.max_x, bounds.max_y}
+        );
+        distance = std::min(distance, glm::distance(point, closest));
+    }
+    return distance;
+}
+
+void
+StreamingManager::_load_cell(const glm::ivec2 cell, _Cell& cell_data)
+{
+    KAACORE_LOG_DEBUG("Loading streaming cell ({}, {}).", cell.x, cell.y);
+    auto root = this->_loader(cell);
+    if (root) {
+        cell_data.root = this->_scene->root_node.add_child(root)->handle();
+    }
+    cell_data.state = StreamingCellState::active;
+}
+
+void
+StreamingManager::_unload_cell(const glm::ivec2 cell, _Cell& cell_data)
+{
+    KAACORE_LOG_DEBUG("Unloading streaming cell ({}, {}).", cell.x, cell.y);
+    NodePtr root = this->_scene->resolve(cell_data.root);
+    if (this->_unloader) {
+        this->_unloader(cell, root);
+    }
+    if (root and not root.is_marked_to_delete()) {
+        root.destroy();
+    }
+    cell_data.root = NodeHandle{};
+    cell_data.state = StreamingCellState::inactive;
+}
+
+} // namespace kaacore
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <mutex>
+#include <utility>
 
 #include "kaacore/threading.h"
 
@@ -14,4 +16,148 @@ SyncedSyscallQueue::finalize_calls()
     this->_queued_functions.clear();
 }
 
+WorkersPool::WorkersPool(const size_t workers_count)
+{
+    this->_threads.reserve(workers_count);
+    for (size_t i = 0; i < workers_count; i++) {
+        this->_threads.emplace_back([this]() { this->_worker_entrypoint(); });
+    }
+}
+
+WorkersPool::~WorkersPool()
+{
+    {
+        std::lock_guard lock{this->_mutex};
+        this->_stopping = true;
+    }
+    this->_work_condition_var.notify_all();
+    for (auto& thread : this->_threads) {
+        thread.join();
+    }
+}
+
+size_t
+WorkersPool::workers_count() const
+{
+    return this->_threads.size();
+}
+
+void
+WorkersPool::parallel_for(
+    const size_t count, const size_t min_range_size, const RangeFunction& func
+)
+{
+    if (count == 0) {
+        return;
+    }
+    if (this->_threads.empty() or count <= min_range_size) {
+        func(0, count);
+        return;
+    }
+
+    const size_t participants = this->_threads.size() + 1;
+    const size_t range_size = std::max(
+        min_range_size, (count + participants - 1) / participants
+    );
+    {
+        std::unique_lock lock{this->_mutex};
+        // worker which woke up late for previous call may still
+        // be checking for ranges, wait until it's done
+        this->_done_condition_var.wait(lock, [this] {
+            return this->_active_workers == 0;
+        });
+        this->_func = &func;
+        this->_count = count;
+        this->_range_size = range_size;
+        this->_ranges_count = (count + range_size - 1) / range_size;
+        this->_finished_ranges = 0;
+        this->_next_range = 0;
+        this->_exception = nullptr;
+        this->_generation++;
+    }
+    this->_work_condition_var.notify_all();
+
+    this->_process_ranges();
+
+    std::exception_ptr exception;
+    {
+        std::unique_lock lock{this->_mutex};
+        this->_done_condition_var.wait(lock, [this] {
+            return this->_finished_ranges == this->_ranges_count and
+                   this->_active_workers == 0;
+        });
+        this->_func = nullptr;
+        exception = std::exchange(this->_exception, nullptr);
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void
+WorkersPool::_worker_entrypoint()
+{
+    uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock{this->_mutex};
+            this->_work_condition_var.wait(lock, [this, seen_generation] {
+                return this->_stopping or
+                       this->_generation != seen_generation;
+            });
+            if (this->_stopping) {
+                return;
+            }
+            seen_generation = this->_generation;
+            this->_active_workers++;
+        }
+
+        this->_process_ranges();
+
+        {
+            std::lock_guard lock{this->_mutex};
+            this->_active_workers--;
+        }
+        this->_done_condition_var.notify_all();
+    }
+}
+
+void
+WorkersPool::_process_ranges()
+{
+    while (true) {
+        const size_t range = this->_next_range.fetch_add(1);
+        if (range >= this->_ranges_count) {
+            return;
+        }
+        const size_t begin = range * this->_range_size;
+        const size_t end = std::min(begin + this->_range_size, this->_count);
+        try {
+            (*this->_func)(begin, end);
+        } catch (...) {
+            std::lock_guard lock{this->_mutex};
+            if (not this->_exception) {
+                this->_exception = std::current_exception();
+            }
+        }
+        {
+            std::lock_guard lock{this->_mutex};
+            this->_finished_ranges++;
+        }
+        this->_done_condition_var.notify_all();
+    }
+}
+
+size_t
+default_workers_count()
+{
+    // main thread and engine loop thread are already busy,
+    // beyond a few workers merging becomes the bottleneck
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    if (hardware_threads <= 2) {
+        return 0;
+    }
+    return std::min<size_t>(hardware_threads - 2, 8);
+}
+
 } // namespace kaacore
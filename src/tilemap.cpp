@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cmath>
+
+#include "kaacore/exceptions.h"
+#include "kaacore/nodes.h"
+#include "kaacore/shapes.h"
+#include "kaacore/utils.h"
+
+#include "kaacore/tilemap.h"
+
+namespace kaacore {
+
+inline constexpr Node*
+container_node(const TilemapNode* tilemap)
+{
+    return container_of(tilemap, &Node::tilemap);
+}
+
+inline int32_t
+floor_divide(const int32_t value, const int32_t divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+TilemapNode::TilemapNode() : _tile_size(16., 16.), _chunk_size(64) {}
+
+TilemapNode::~TilemapNode() {}
+
+TilemapNode::Chunk&
+TilemapNode::_get_or_create_chunk(const glm::ivec2 chunk_position)
+{
+    auto [it, inserted] = this->_chunks.try_emplace(chunk_position);
+    Chunk& chunk = it->second;
+    if (inserted) {
+        chunk.tiles.resize(this->_chunk_size * this->_chunk_size, empty_tile);
+        // chunk nodes are created right away, so they are already
+        // in the tree when the tilemap is processed in the next frame
+        auto chunk_node = make_node();
+        chunk_node->position(this->_chunk_origin(chunk_position));
+        chunk.node = container_node(this)->add_child(chunk_node).get();
+    }
+    return chunk;
+}
+
+void
+TilemapNode::_mark_chunk_dirty(const glm::ivec2 chunk_position, Chunk& chunk)
+{
+    if (not chunk.is_dirty) {
+        chunk.is_dirty = true;
+        this->_dirty_chunks.push_back(chunk_position);
+    }
+}
+
+void
+TilemapNode::_mark_all_chunks_dirty()
+{
+    for (auto& [chunk_position, chunk] : this->_chunks) {
+        chunk.node->position(this->_chunk_origin(chunk_position));
+        this->_mark_chunk_dirty(chunk_position, chunk);
+    }
+}
+
+void
+TilemapNode::_rebuild_chunk(Chunk& chunk)
+{
+    std::vector<StandardVertexData> vertices;
+    std::vector<VertexIndex> indices;
+    vertices.reserve(chunk.tiles_count * 4);
+    indices.reserve(chunk.tiles_count * 6);
+
+    // vertices uv are relative to the atlas sprite, node
+    // maps them onto the texture when computing vertices
+    glm::dvec2 frame_uv_size = {1., 1.};
+    uint32_t atlas_columns = 1;
+    if (this->_atlas) {
+        const glm::dvec2 atlas_size = this->_atlas.get_size();
+        frame_uv_size = this->_tile_size / atlas_size;
+        atlas_columns = std::max<uint32_t>(
+            1, std::floor(atlas_size.x / this->_tile_size.x)
+        );
+    }
+
+    const double tile_width = this->_tile_size.x;
+    const double tile_height = this->_tile_size.y;
+    for (uint32_t y = 0; y < this->_chunk_size; y++) {
+        for (uint32_t x = 0; x < this->_chunk_size; x++) {
+            const TileId tile_id = chunk.tiles[y * this->_chunk_size + x];
+            if (tile_id == empty_tile) {
+                continue;
+            }
+
+            const glm::dvec2 frame_position = {
+                tile_id % atlas_columns, tile_id / atlas_columns
+            };
+            const glm::dvec2 uv_min = frame_position * frame_uv_size;
+            const glm::dvec2 uv_max = uv_min + frame_uv_size;
+            const double min_x = x * tile_width;
+            const double min_y = y * tile_height;
+            const double max_x = min_x + tile_width;
+            const double max_y = min_y + tile_height;
+
+            const VertexIndex first_vertex = vertices.size();
+            vertices.push_back(
+                StandardVertexData::xy_uv(min_x, min_y, uv_min.x, uv_min.y)
+            );
+            vertices.push_back(
+                StandardVertexData::xy_uv(max_x, min_y, uv_max.x, uv_min.y)
+            );
+            vertices.push_back(
+                StandardVertexData::xy_uv(max_x, max_y, uv_max.x, uv_max.y)
+            );
+            vertices.push_back(
+                StandardVertexData::xy_uv(min_x, max_y, uv_min.x, uv_max.y)
+            );
+            for (VertexIndex offset : {0, 2, 1, 0, 3, 2}) {
+                indices.push_back(first_vertex + offset);
+            }
+        }
+    }
+
+    chunk.is_dirty = false;
+    chunk.node->shape(Shape::Freeform(indices, vertices));
+    chunk.node->sprite(this->_atlas);
+}
+
+void
+TilemapNode::_destroy_chunk_node(Node* chunk_node)
+{
+    NodePtr chunk_node_ptr{chunk_node};
+    if (chunk_node->scene() == nullptr) {
+        chunk_node->_detach_from_parent();
+        delete chunk_node;
+    } else if (not chunk_node_ptr.is_marked_to_delete()) {
+        chunk_node_ptr.destroy();
+    }
+}
+
+glm::dvec2
+TilemapNode::_chunk_origin(const glm::ivec2 chunk_position) const
+{
+    return glm::dvec2(chunk_position) * double(this->_chunk_size) *
+           this->_tile_size;
+}
+
+Sprite
+TilemapNode::atlas() const
+{
+    return this->_atlas;
+}
+
+void
+TilemapNode::atlas(const Sprite& atlas)
+{
+    this->_atlas = atlas;
+    this->_mark_all_chunks_dirty();
+}
+
+glm::dvec2
+TilemapNode::tile_size() const
+{
+    return this->_tile_size;
+}
+
+void
+TilemapNode::tile_size(const glm::dvec2 tile_size)
+{
+    KAACORE_CHECK(
+        tile_size.x > 0. and tile_size.y > 0., "Tile size must be positive."
+    );
+    this->_tile_size = tile_size;
+    this->_mark_all_chunks_dirty();
+}
+
+uint32_t
+TilemapNode::chunk_size() const
+{
+    return this->_chunk_size;
+}
+
+void
+TilemapNode::chunk_size(const uint32_t chunk_size)
+{
+    KAACORE_CHECK(
+        chunk_size > 0 and chunk_size <= max_tilemap_chunk_size,
+        "Chunk size must be in range [1, {}].", max_tilemap_chunk_size
+    );
+    KAACORE_CHECK(
+        this->_chunks.empty(), "Chunk size can't be changed in non-empty map."
+    );
+    this->_chunk_size = chunk_size;
+}
+
+TileId
+TilemapNode::tile(const glm::ivec2 tile_position) const
+{
+    const auto chunk_position = this->chunk_position(tile_position);
+    const auto it = this->_chunks.find(chunk_position);
+    if (it == this->_chunks.end()) {
+        return empty_tile;
+    }
+    const glm::ivec2 local_position =
+        tile_position - chunk_position * int32_t(this->_chunk_size);
+    return it->second
+        .tiles[local_position.y * this->_chunk_size + local_position.x];
+}
+
+void
+TilemapNode::tile(const glm::ivec2 tile_position, const TileId tile_id)
+{
+    this->fill(tile_position, tile_position, tile_id);
+}
+
+void
+TilemapNode::fill(
+    const glm::ivec2 first_tile_position, const glm::ivec2 last_tile_position,
+    const TileId tile_id
+)
+{
+    const glm::ivec2 min_position =
+        glm::min(first_tile_position, last_tile_position);
+    const glm::ivec2 max_position =
+        glm::max(first_tile_position, last_tile_position);
+    const glm::ivec2 min_chunk = this->chunk_position(min_position);
+    const glm::ivec2 max_chunk = this->chunk_position(max_position);
+    const int32_t chunk_size = this->_chunk_size;
+
+    // filled area is processed chunk by chunk,
+    // so every chunk is looked up only once
+    for (int32_t chunk_y = min_chunk.y; chunk_y <= max_chunk.y; chunk_y++) {
+        for (int32_t chunk_x = min_chunk.x; chunk_x <= max_chunk.x;
+             chunk_x++) {
+            const glm::ivec2 chunk_position = {chunk_x, chunk_y};
+            Chunk* chunk;
+            if (tile_id == empty_tile) {
+                auto it = this->_chunks.find(chunk_position);
+                if (it == this->_chunks.end()) {
+                    continue;
+                }
+                chunk = &it->second;
+            } else {
+                chunk = &this->_get_or_create_chunk(chunk_position);
+            }
+
+            const glm::ivec2 chunk_first_tile = chunk_position * chunk_size;
+            const glm::ivec2 local_min =
+                glm::max(min_position - chunk_first_tile, glm::ivec2{0, 0});
+            const glm::ivec2 local_max = glm::min(
+                max_position - chunk_first_tile,
+                glm::ivec2{chunk_size - 1, chunk_size - 1}
+            );
+            bool modified = false;
+            for (int32_t y = local_min.y; y <= local_max.y; y++) {
+                for (int32_t x = local_min.x; x <= local_max.x; x++) {
+                    TileId& current_id = chunk->tiles[y * chunk_size + x];
+                    if (current_id == tile_id) {
+                        continue;
+                    }
+                    if (current_id == empty_tile) {
+                        chunk->tiles_count++;
+                    } else if (tile_id == empty_tile) {
+                        chunk->tiles_count--;
+                    }
+                    current_id = tile_id;
+                    modified = true;
+                }
+            }
+            if (modified) {
+                this->_mark_chunk_dirty(chunk_position, *chunk);
+            }
+        }
+    }
+}
+
+void
+TilemapNode::clear()
+{
+    Node* node = container_node(this);
+    if (node->_children.size() == this->_chunks.size()) {
+        // only chunks are attached, drop them all in bulk
+        node->destroy_children();
+    } else {
+        for (auto& [chunk_position, chunk] : this->_chunks) {
+            this->_destroy_chunk_node(chunk.node);
+        }
+    }
+    this->_chunks.clear();
+    this->_dirty_chunks.clear();
+}
+
+glm::ivec2
+TilemapNode::tile_position_at(const glm::dvec2 position) const
+{
+    return glm::ivec2(glm::floor(position / this->_tile_size));
+}
+
+TileId
+TilemapNode::tile_at(const glm::dvec2 position) const
+{
+    return this->tile(this->tile_position_at(position));
+}
+
+glm::ivec2
+TilemapNode::chunk_position(const glm::ivec2 tile_position) const
+{
+    return {
+        floor_divide(tile_position.x, this->_chunk_size),
+        floor_divide(tile_position.y, this->_chunk_size)
+    };
+}
+
+std::vector<glm::ivec2>
+TilemapNode::chunks_positions() const
+{
+    std::vector<glm::ivec2> positions;
+    positions.reserve(this->_chunks.size());
+    for (const auto& [chunk_position, chunk] : this->_chunks) {
+        positions.push_back(chunk_position);
+    }
+    return positions;
+}
+
+const std::vector<TileId>&
+TilemapNode::chunk_tiles(const glm::ivec2 chunk_position) const
+{
+    const auto it = this->_chunks.find(chunk_position);
+    KAACORE_CHECK(it != this->_chunks.end(), "Chunk does not exist.");
+    return it->second.tiles;
+}
+
+void
+TilemapNode::chunk_tiles(
+    const glm::ivec2 chunk_position, const std::vector<TileId>& tiles
+)
+{
+    KAACORE_CHECK(
+        tiles.size() == this->_chunk_size * this->_chunk_size,
+        "Invalid number of tiles for chunk of size {}.", this->_chunk_size
+    );
+    Chunk& chunk = this->_get_or_create_chunk(chunk_position);
+    chunk.tiles = tiles;
+    chunk.tiles_count =
+        tiles.size() - std::count(tiles.begin(), tiles.end(), empty_tile);
+    this->_mark_chunk_dirty(chunk_position, chunk);
+}
+
+Node*
+TilemapNode::chunk_node(const glm::ivec2 chunk_position) const
+{
+    const auto it = this->_chunks.find(chunk_position);
+    if (it == this->_chunks.end()) {
+        return nullptr;
+    }
+    return it->second.node;
+}
+
+size_t
+TilemapNode::chunks_count() const
+{
+    return this->_chunks.size();
+}
+
+size_t
+TilemapNode::dirty_chunks_count() const
+{
+    return this->_dirty_chunks.size();
+}
+
+void
+TilemapNode::rebuild_dirty_chunks()
+{
+    for (const auto chunk_position : this->_dirty_chunks) {
+        auto it = this->_chunks.find(chunk_position);
+        if (it == this->_chunks.end()) {
+            continue;
+        }
+        Chunk& chunk = it->second;
+        if (chunk.tiles_count == 0) {
+            // chunks emptied completely are dropped along with their nodes
+            this->_destroy_chunk_node(chunk.node);
+            this->_chunks.erase(it);
+            continue;
+        }
+        this->_rebuild_chunk(chunk);
+    }
+    this->_dirty_chunks.clear();
+}
+
+} // namespace kaacore
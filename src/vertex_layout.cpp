@@ -1,3 +1,27 @@
 #include "kaacore/vertex_layout.h"
 
-namespace kaacore {} // namespace kaacore
+namespace kaacore {
+
+void
+transform_vertices(
+    const StandardVertexData* source, StandardVertexData* destination,
+    const size_t count, const VertexTransformParams& params
+)
+{
+    for (size_t i = 0; i < count; i++) {
+        const StandardVertexData& src = source[i];
+        StandardVertexData& dst = destination[i];
+        const float x = src.xyz.x;
+        const float y = src.xyz.y;
+        dst.xyz.x =
+            x * params.x_axis.x + y * params.y_axis.x + params.translation.x;
+        dst.xyz.y =
+            x * params.x_axis.y + y * params.y_axis.y + params.translation.y;
+        dst.xyz.z = src.xyz.z;
+        dst.uv = src.uv * params.uv_span + params.uv_origin;
+        dst.mn = src.mn;
+        dst.rgba = params.color;
+    }
+}
+
+} // namespace kaacore
@@ -1,4 +1,7 @@
 #include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <unordered_map>
 #include <vector>
 
 #include <catch2/catch.hpp>
@@ -6,6 +9,7 @@
 
 #include "kaacore/draw_unit.h"
 #include "kaacore/engine.h"
+#include "kaacore/threading.h"
 
 #include "runner.h"
 
@@ -701,3 +705,121 @@ TEST_CASE("test_draw_bucket_modifications", "[draw_unit][draw_bucket]")
         reset_modifications(node_txt);
     }
 }
+
+TEST_CASE("test_workers_pool", "[draw_unit][no_engine]")
+{
+    kaacore::WorkersPool pool{3};
+    REQUIRE(pool.workers_count() == 3);
+
+    SECTION("Ranges cover all items")
+    {
+        std::vector<int> items(1000, 0);
+        std::atomic<size_t> calls = 0;
+        std::atomic<size_t> too_short_ranges = 0;
+        for (int round = 0; round < 10; round++) {
+            pool.parallel_for(
+                items.size(), 10, [&](const size_t begin, const size_t end) {
+                    // Catch assertions are not thread safe
+                    if (end - begin < 10) {
+                        too_short_ranges++;
+                    }
+                    for (size_t i = begin; i < end; i++) {
+                        items[i]++;
+                    }
+                    calls++;
+                }
+            );
+        }
+        REQUIRE(calls > 10);
+        REQUIRE(too_short_ranges == 0);
+        for (const int item : items) {
+            REQUIRE(item == 10);
+        }
+    }
+
+    SECTION("Small counts run inline")
+    {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        pool.parallel_for(10, 10, [&](const size_t begin, const size_t end) {
+            ranges.emplace_back(begin, end);
+        });
+        REQUIRE(ranges.size() == 1);
+        REQUIRE(ranges[0] == std::make_pair<size_t, size_t>(0, 10));
+    }
+
+    SECTION("Exception is rethrown")
+    {
+        REQUIRE_THROWS_AS(
+            pool.parallel_for(
+                100, 1,
+                [](const size_t begin, const size_t end) {
+                    if (begin <= 50 and 50 < end) {
+                        throw std::runtime_error("Failed range");
+                    }
+                }
+            ),
+            std::runtime_error
+        );
+        // pool is still usable
+        std::atomic<size_t> processed = 0;
+        pool.parallel_for(100, 1, [&](const size_t begin, const size_t end) {
+            processed += end - begin;
+        });
+        REQUIRE(processed == 100);
+    }
+}
+
+TEST_CASE("test_parallel_draw_unit_vertices", "[draw_unit]")
+{
+    auto engine = initialize_testing_engine();
+    engine->workers_pool = std::make_unique<kaacore::WorkersPool>(3);
+    TestingScene scene;
+
+    std::vector<kaacore::NodePtr> nodes;
+    for (int i = 0; i < 1000; i++) {
+        auto node = kaacore::make_node();
+        node->shape(
+            i % 2 ? kaacore::Shape::Box({10., 5.})
+                  : kaacore::Shape::Circle(3., {1., 2.})
+        );
+        node->position({i * 1.5, i * -0.5});
+        node->rotation(i * 0.01);
+        node->color({(i % 10) / 10., 0.5, 1., 1.});
+        if (i % 3 and not nodes.empty()) {
+            nodes.push_back(nodes.back()->add_child(node));
+        } else {
+            nodes.push_back(scene.root_node.add_child(node));
+        }
+    }
+
+    const auto validate_draw_queue = [&]() {
+        std::unordered_map<kaacore::DrawUnitId, kaacore::NodePtr> nodes_map;
+        for (const auto& node : nodes) {
+            nodes_map[node->scene_tree_id()] = node;
+        }
+        size_t draw_units_count = 0;
+        for (const auto& [key, bucket] : scene.draw_queue) {
+            for (const auto& draw_unit : bucket.draw_units) {
+                auto node = nodes_map.at(draw_unit.id);
+                // computing serially gives the same result
+                const auto [vertices, indices] =
+                    node->recalculate_vertices_indices_data();
+                REQUIRE(draw_unit.details.vertices == vertices);
+                REQUIRE(draw_unit.details.indices == indices);
+                draw_units_count++;
+            }
+        }
+        REQUIRE(draw_units_count == nodes.size());
+    };
+
+    scene.update_nodes_drawing_queue(scene.build_processing_queue());
+    scene.draw_queue.process_modifications();
+    validate_draw_queue();
+
+    for (size_t i = 0; i < nodes.size(); i += 7) {
+        nodes[i]->position(nodes[i]->position() + glm::dvec2{3., 4.});
+    }
+    scene.update_nodes_drawing_queue(scene.build_processing_queue());
+    scene.draw_queue.process_modifications();
+    validate_draw_queue();
+}
@@ -1,6 +1,8 @@
 #include <cmath>
+#include <vector>
 
 #include <catch2/catch.hpp>
+#include <glm/glm.hpp>
 
 #include "kaacore/geometry.h"
 
@@ -77,3 +79,96 @@ TEST_CASE(
         REQUIRE(bbox_out == bbox_a);
     }
 }
+
+TEST_CASE(
+    "test_affine_transformation", "[geometry][transformation][no_engine]"
+)
+{
+    using kaacore::AffineTransformation;
+
+    const auto first = AffineTransformation<double>::from_components(
+        {10., -5.}, 0.75, {2., 3.}
+    );
+    const auto second = AffineTransformation<double>::from_components(
+        {-3., 7.}, -2.1, {0.5, -1.5}
+    );
+    const glm::dmat4 first_matrix = first.to_mat4();
+    const glm::dmat4 second_matrix = second.to_mat4();
+    const glm::dvec2 point = {4., -9.};
+
+    auto require_same = [](const AffineTransformation<double>& transformation,
+                           const glm::dmat4& matrix) {
+        const AffineTransformation<double> expected{matrix};
+        REQUIRE(transformation.x_axis.x == Approx(expected.x_axis.x));
+        REQUIRE(transformation.x_axis.y == Approx(expected.x_axis.y));
+        REQUIRE(transformation.y_axis.x == Approx(expected.y_axis.x));
+        REQUIRE(transformation.y_axis.y == Approx(expected.y_axis.y));
+        REQUIRE(transformation.translation.x == Approx(expected.translation.x));
+        REQUIRE(transformation.translation.y == Approx(expected.translation.y));
+    };
+
+    require_same(first * second, first_matrix * second_matrix);
+    require_same(first.inverse(), glm::inverse(first_matrix));
+    require_same(first * first.inverse(), glm::dmat4(1.));
+
+    const glm::dvec4 expected_point = first_matrix * glm::dvec4{point, 0., 1.};
+    REQUIRE(first.apply(point).x == Approx(expected_point.x));
+    REQUIRE(first.apply(point).y == Approx(expected_point.y));
+
+    const kaacore::DecomposedTransformation<double> decomposed{first};
+    const kaacore::DecomposedTransformation<double> expected_decomposed{
+        first_matrix
+    };
+    REQUIRE(decomposed.rotation == Approx(expected_decomposed.rotation));
+    REQUIRE(decomposed.scale.x == Approx(expected_decomposed.scale.x));
+    REQUIRE(decomposed.scale.y == Approx(expected_decomposed.scale.y));
+
+    const auto transformation = kaacore::Transformation::translate({1., 2.}) |
+                                kaacore::Transformation::rotate(0.5) |
+                                kaacore::Transformation::scale({2., 2.});
+    const auto composed = transformation | transformation.inverse();
+    REQUIRE(composed.at(0, 0) == Approx(1.));
+    REQUIRE(composed.at(3, 0) == Approx(0.).margin(1e-12));
+    REQUIRE(composed.at(3, 3) == 1.);
+}
+
+TEST_CASE(
+    "benchmark_affine_transformation",
+    "[.][benchmark][geometry][transformation][no_engine]"
+)
+{
+    using kaacore::AffineTransformation;
+
+    // compact representation stored in every node
+    REQUIRE(sizeof(AffineTransformation<float>) == 6 * sizeof(float));
+    REQUIRE(sizeof(AffineTransformation<float>) < sizeof(glm::fmat4));
+
+    std::vector<AffineTransformation<float>> local_transformations;
+    std::vector<glm::fmat4> local_matrices;
+    for (size_t i = 0; i < 10000; i++) {
+        local_transformations.push_back(
+            AffineTransformation<float>::from_components(
+                {i * 0.5f, i * -0.25f}, i * 0.01f, {1.001f, 0.999f}
+            )
+        );
+        local_matrices.push_back(local_transformations.back().to_mat4());
+    }
+
+    BENCHMARK("10k chained transformations, 4x4 matrices")
+    {
+        glm::fmat4 matrix(1.f);
+        for (const auto& local_matrix : local_matrices) {
+            matrix = matrix * local_matrix;
+        }
+        return matrix;
+    };
+
+    BENCHMARK("10k chained transformations, 2x3 affine")
+    {
+        AffineTransformation<float> transformation;
+        for (const auto& local_transformation : local_transformations) {
+            transformation = transformation * local_transformation;
+        }
+        return transformation;
+    };
+}
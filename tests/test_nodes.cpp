@@ -0,0 +1,1003 @@
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/engine.h"
+#include "kaacore/nodes.h"
+#include "kaacore/nodes_batch.h"
+#include "kaacore/scenes.h"
+
+#include "runner.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("test_recursive_dirty_flags_propagation", "[nodes][dirty_flags]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto add_chain = [](kaacore::NodePtr parent, size_t length) {
+        std::vector<kaacore::NodePtr> chain;
+        for (size_t i = 0; i < length; i++) {
+            auto tmp_node = kaacore::make_node();
+            parent = parent->add_child(tmp_node);
+            chain.push_back(parent);
+        }
+        return chain;
+    };
+
+    auto panel_tmp = kaacore::make_node();
+    auto panel = scene.root_node.add_child(panel_tmp);
+    auto chain_a = add_chain(panel, 10);
+    auto chain_b = add_chain(panel, 10);
+    auto sibling_tmp = kaacore::make_node();
+    auto sibling = scene.root_node.add_child(sibling_tmp);
+    auto sibling_chain = add_chain(sibling, 5);
+
+    // subtree built outside of the scene and attached in one go
+    auto detached = kaacore::make_node();
+    auto detached_chain = add_chain(detached, 5);
+    auto attached = chain_a[4]->add_child(detached);
+
+    auto clear_all = [&scene]() {
+        scene.root_node.recursive_call_downstream([](kaacore::Node* node) {
+            node->clear_dirty_flags(kaacore::Node::DIRTY_ALL);
+        });
+    };
+    auto is_dirty = [](const kaacore::NodePtr& node) {
+        return node->query_dirty_flags(kaacore::Node::DIRTY_MODEL_MATRIX);
+    };
+
+    SECTION("Marking whole subtree")
+    {
+        clear_all();
+        panel->position({10., 0.});
+        REQUIRE(is_dirty(panel));
+        for (const auto& node : chain_a) {
+            REQUIRE(is_dirty(node));
+        }
+        for (const auto& node : chain_b) {
+            REQUIRE(is_dirty(node));
+        }
+        REQUIRE(is_dirty(attached));
+        for (const auto& node : detached_chain) {
+            REQUIRE(is_dirty(node));
+        }
+        REQUIRE_FALSE(is_dirty(sibling));
+        for (const auto& node : sibling_chain) {
+            REQUIRE_FALSE(is_dirty(node));
+        }
+    }
+
+    SECTION("Marking nested subtree")
+    {
+        clear_all();
+        chain_a[4]->position({10., 0.});
+        for (size_t i = 0; i < chain_a.size(); i++) {
+            REQUIRE(is_dirty(chain_a[i]) == (i >= 4));
+        }
+        REQUIRE(is_dirty(attached));
+        REQUIRE_FALSE(is_dirty(panel));
+        for (const auto& node : chain_b) {
+            REQUIRE_FALSE(is_dirty(node));
+        }
+    }
+
+    SECTION("Marking after removal")
+    {
+        chain_a[2].destroy();
+        scene.remove_marked_nodes();
+
+        clear_all();
+        panel->position({10., 0.});
+        REQUIRE(is_dirty(chain_a[1]));
+        for (const auto& node : chain_b) {
+            REQUIRE(is_dirty(node));
+        }
+        REQUIRE_FALSE(is_dirty(sibling));
+
+        clear_all();
+        auto tmp_node = kaacore::make_node();
+        auto new_node = chain_a[1]->add_child(tmp_node);
+        new_node->clear_dirty_flags(kaacore::Node::DIRTY_ALL);
+        chain_a[0]->position({10., 0.});
+        REQUIRE(is_dirty(new_node));
+        REQUIRE_FALSE(is_dirty(chain_b[0]));
+    }
+
+    SECTION("Processing queue")
+    {
+        chain_b[0].destroy();
+        const auto& processing_queue = scene.build_processing_queue();
+        REQUIRE(processing_queue.size() == 1 + 1 + 10 + 1 + 5 + 1 + 5);
+        REQUIRE(processing_queue[0] == &scene.root_node);
+        for (const auto& node : chain_b) {
+            REQUIRE(
+                std::find(
+                    processing_queue.begin(), processing_queue.end(),
+                    node.get()
+                ) == processing_queue.end()
+            );
+        }
+        for (size_t i = 1; i < processing_queue.size(); i++) {
+            auto parent_position = std::find(
+                processing_queue.begin(), processing_queue.begin() + i,
+                processing_queue[i]->parent().get()
+            );
+            REQUIRE(parent_position != processing_queue.begin() + i);
+        }
+        scene.remove_marked_nodes();
+    }
+}
+
+TEST_CASE("test_children_removal", "[nodes][removal]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto container_tmp = kaacore::make_node();
+    auto container = scene.root_node.add_child(container_tmp);
+    std::vector<kaacore::NodePtr> children;
+    for (size_t i = 0; i < 10; i++) {
+        auto tmp_node = kaacore::make_node();
+        auto child = container->add_child(tmp_node);
+        auto tmp_grandchild = kaacore::make_node();
+        child->add_child(tmp_grandchild);
+        children.push_back(child);
+    }
+
+    SECTION("Removing selected children keeps the order")
+    {
+        children[0].destroy();
+        children[4].destroy();
+        children[9].destroy();
+        REQUIRE(container->children().size() == 7);
+        scene.remove_marked_nodes();
+
+        std::vector<kaacore::Node*> expected_children;
+        for (size_t i : {1, 2, 3, 5, 6, 7, 8}) {
+            expected_children.push_back(children[i].get());
+        }
+        REQUIRE(container->children() == expected_children);
+
+        children[5].destroy();
+        scene.remove_marked_nodes();
+        expected_children.erase(expected_children.begin() + 3);
+        REQUIRE(container->children() == expected_children);
+    }
+
+    SECTION("Destroying children of node in the tree")
+    {
+        container->destroy_children();
+        REQUIRE(container->children().empty());
+        for (const auto& child : children) {
+            REQUIRE(child.is_marked_to_delete());
+        }
+        scene.remove_marked_nodes();
+        REQUIRE(container->children().empty());
+        REQUIRE(scene.build_processing_queue().size() == 2);
+    }
+
+    SECTION("Destroying children of detached node")
+    {
+        auto detached = kaacore::make_node();
+        for (size_t i = 0; i < 10; i++) {
+            auto tmp_node = kaacore::make_node();
+            detached->add_child(tmp_node);
+        }
+        detached->destroy_children();
+        REQUIRE(detached->children().empty());
+    }
+
+    SECTION("Destroying container with marked children")
+    {
+        children[3].destroy();
+        container.destroy();
+        REQUIRE_NOTHROW(scene.remove_marked_nodes());
+        REQUIRE(scene.root_node.children().empty());
+    }
+}
+
+TEST_CASE("test_relative_position_queries", "[nodes][no_engine]")
+{
+    kaacore::initialize_logging();
+
+    const auto local_transformation = [](const size_t i) {
+        return kaacore::Transformation::scale({1.5, 0.5 + i}) |
+               kaacore::Transformation::rotate(0.25 * i) |
+               kaacore::Transformation::translate({10., 5. * i});
+    };
+
+    auto root = kaacore::make_node();
+    auto tmp_node = kaacore::make_node();
+    auto ancestor = root->add_child(tmp_node);
+    std::vector<kaacore::Node*> descendants;
+    kaacore::NodePtr parent = ancestor;
+    for (size_t i = 0; i < 5; i++) {
+        auto tmp_child = kaacore::make_node();
+        parent = parent->add_child(tmp_child);
+        parent->position({10., 5. * i});
+        parent->rotation(0.25 * i);
+        parent->scale({1.5, 0.5 + i});
+        descendants.push_back(parent.get());
+    }
+    root->position({-100., 250.});
+    ancestor->position({30., -20.});
+    ancestor->rotation(1.2);
+    ancestor->scale({2., 3.});
+
+    // node's own transformation is applied first, then its parents' ones,
+    // up to the ancestor (excluded)
+    std::vector<glm::dvec2> expected_positions;
+    kaacore::Transformation chain;
+    for (size_t i = 0; i < descendants.size(); i++) {
+        chain = local_transformation(i) | chain;
+        expected_positions.push_back(glm::dvec2{0., 0.} | chain);
+    }
+
+    const auto require_expected_positions =
+        [&](const std::vector<glm::dvec2>& positions) {
+            REQUIRE(positions.size() == expected_positions.size());
+            for (size_t i = 0; i < positions.size(); i++) {
+                REQUIRE(
+                    positions[i].x ==
+                    Approx(expected_positions[i].x).margin(1e-9)
+                );
+                REQUIRE(
+                    positions[i].y ==
+                    Approx(expected_positions[i].y).margin(1e-9)
+                );
+            }
+        };
+    const auto query_positions = [&]() {
+        std::vector<glm::dvec2> positions;
+        for (auto node : descendants) {
+            positions.push_back(node->get_relative_position(ancestor.get()));
+        }
+        return positions;
+    };
+
+    SECTION("Dirty model matrices")
+    {
+        require_expected_positions(query_positions());
+    }
+
+    SECTION("Cached model matrices")
+    {
+        for (auto node : descendants) {
+            node->absolute_position();
+        }
+        require_expected_positions(query_positions());
+    }
+
+    SECTION("Far from origin")
+    {
+        // absolute positions this large lose precision in float
+        root->position({1e7, -1e7});
+        ancestor->position({3e6, 2e6});
+        for (auto node : descendants) {
+            node->absolute_position();
+        }
+        require_expected_positions(query_positions());
+        require_expected_positions(
+            kaacore::Node::get_relative_positions(descendants, ancestor.get())
+        );
+    }
+
+    SECTION("Batched query")
+    {
+        require_expected_positions(
+            kaacore::Node::get_relative_positions(descendants, ancestor.get())
+        );
+
+        // deepest node first, then nodes sharing only part of its path
+        std::vector<kaacore::Node*> interleaved;
+        std::vector<glm::dvec2> interleaved_expected;
+        for (size_t i = 0; i < descendants.size(); i++) {
+            const size_t index = i % 2 ? i / 2 : descendants.size() - 1 - i / 2;
+            interleaved.push_back(descendants[index]);
+            interleaved_expected.push_back(expected_positions[index]);
+        }
+        std::swap(expected_positions, interleaved_expected);
+        require_expected_positions(
+            kaacore::Node::get_relative_positions(interleaved, ancestor.get())
+        );
+        std::swap(expected_positions, interleaved_expected);
+
+        auto absolute_positions =
+            kaacore::Node::get_relative_positions(descendants, nullptr);
+        for (size_t i = 0; i < descendants.size(); i++) {
+            auto expected = descendants[i]->absolute_position();
+            REQUIRE(absolute_positions[i].x == Approx(expected.x));
+            REQUIRE(absolute_positions[i].y == Approx(expected.y));
+        }
+    }
+
+    SECTION("Non-ancestor query")
+    {
+        auto tmp_other = kaacore::make_node();
+        auto other = root->add_child(tmp_other);
+        other->absolute_position();
+        descendants[2]->absolute_position();
+        REQUIRE_THROWS(descendants[2]->get_relative_position(other.get()));
+        REQUIRE_THROWS(
+            kaacore::Node::get_relative_positions(descendants, other.get())
+        );
+    }
+}
+
+TEST_CASE("test_nodes_lifetime_queue", "[nodes][lifetime][no_engine]")
+{
+    kaacore::initialize_logging();
+
+    std::vector<kaacore::NodeOwnerPtr> nodes;
+    for (size_t i = 0; i < 100; i++) {
+        nodes.push_back(kaacore::make_node());
+    }
+
+    kaacore::NodesLifetimeQueue queue;
+    // lifetimes: 1ms, 2ms, ... 100ms scheduled in shuffled order
+    for (size_t i = 0; i < nodes.size(); i++) {
+        size_t index = (i * 37) % nodes.size();
+        queue.schedule(
+            nodes[index].get(), std::chrono::milliseconds(index + 1)
+        );
+    }
+    // every third node is unscheduled, every fifth rescheduled
+    for (size_t i = 0; i < nodes.size(); i += 3) {
+        queue.unschedule(nodes[i].get());
+    }
+    for (size_t i = 1; i < nodes.size(); i += 5) {
+        queue.schedule(nodes[i].get(), 200ms);
+    }
+
+    REQUIRE(queue.remaining(nodes[1].get()) == 200ms);
+    REQUIRE(queue.pop_expired() == nullptr);
+
+    std::vector<kaacore::Node*> expired;
+    for (size_t step = 0; step < 250; step++) {
+        queue.advance(1ms);
+        while (auto node = queue.pop_expired()) {
+            expired.push_back(node);
+        }
+    }
+    REQUIRE(queue.size() == 0);
+
+    std::vector<kaacore::Node*> expected;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (i % 3 != 0 or i % 5 == 1) {
+            expected.push_back(nodes[i].get());
+        }
+    }
+    REQUIRE(expired.size() == expected.size());
+    REQUIRE(
+        std::is_permutation(expired.begin(), expired.end(), expected.begin())
+    );
+}
+
+TEST_CASE("test_nodes_lifetime_expiration", "[nodes][lifetime]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_short = kaacore::make_node();
+    tmp_short->lifetime(100ms);
+    auto short_lived = scene.root_node.add_child(tmp_short);
+    auto tmp_child = kaacore::make_node();
+    tmp_child->lifetime(1s);
+    auto child = short_lived->add_child(tmp_child);
+    auto tmp_long = kaacore::make_node();
+    auto long_lived = scene.root_node.add_child(tmp_long);
+    long_lived->lifetime(250ms);
+    auto tmp_immortal = kaacore::make_node();
+    auto immortal = scene.root_node.add_child(tmp_immortal);
+
+    auto process_frame = [&scene]() {
+        scene.process_nodes(60ms, scene.build_processing_queue());
+    };
+
+    process_frame();
+    REQUIRE(short_lived->lifetime().count() == Approx(0.04));
+    REQUIRE(child->lifetime().count() == Approx(0.94));
+
+    process_frame();
+    REQUIRE(short_lived.is_marked_to_delete());
+    REQUIRE(child.is_marked_to_delete());
+    REQUIRE_FALSE(long_lived.is_marked_to_delete());
+    scene.remove_marked_nodes();
+
+    long_lived->lifetime(100ms);
+    process_frame();
+    process_frame();
+    REQUIRE(long_lived.is_marked_to_delete());
+    REQUIRE_FALSE(immortal.is_marked_to_delete());
+    REQUIRE(immortal->lifetime().count() == 0.);
+    scene.remove_marked_nodes();
+}
+
+TEST_CASE("test_offscreen_update_policy", "[nodes][offscreen]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+    const glm::dvec2 far_position = {1e6, 1e6};
+
+    auto tmp_container = kaacore::make_node();
+    auto container = scene.root_node.add_child(tmp_container);
+    auto tmp_node = kaacore::make_node();
+    tmp_node->shape(kaacore::Shape::Box({10., 10.}));
+    tmp_node->position(far_position);
+    tmp_node->lifetime(100ms);
+    auto node = container->add_child(tmp_node);
+    auto tmp_visible_node = kaacore::make_node();
+    tmp_visible_node->shape(kaacore::Shape::Box({10., 10.}));
+    tmp_visible_node->position(scene.camera().position());
+    auto visible_node = scene.root_node.add_child(tmp_visible_node);
+
+    auto process_frame = [&scene]() {
+        auto& processing_queue = scene.build_processing_queue();
+        scene.update_nodes_drawing_queue(processing_queue);
+        scene.process_nodes(60ms, processing_queue);
+    };
+
+    SECTION("Pause drawing")
+    {
+        container->offscreen_update_policy(
+            kaacore::OffscreenUpdatePolicy::pause_drawing
+        );
+        process_frame();
+        REQUIRE(container->is_offscreen_paused());
+        REQUIRE(node->is_offscreen_paused());
+        REQUIRE_FALSE(visible_node->is_offscreen_paused());
+        REQUIRE(node->query_dirty_flags(kaacore::Node::DIRTY_DRAW_VERTICES));
+        REQUIRE_FALSE(
+            visible_node->query_dirty_flags(kaacore::Node::DIRTY_DRAW_VERTICES)
+        );
+        // lifetime is not affected
+        REQUIRE(node->lifetime().count() == Approx(0.04));
+
+        node->position(scene.camera().position());
+        process_frame();
+        REQUIRE_FALSE(node->is_offscreen_paused());
+        REQUIRE_FALSE(
+            node->query_dirty_flags(kaacore::Node::DIRTY_DRAW_VERTICES)
+        );
+        REQUIRE(node.is_marked_to_delete());
+    }
+
+    SECTION("Pause all")
+    {
+        container->offscreen_update_policy(
+            kaacore::OffscreenUpdatePolicy::pause_all
+        );
+        process_frame();
+        process_frame();
+        REQUIRE(node->is_offscreen_paused());
+        REQUIRE(node->lifetime().count() == Approx(0.1));
+        REQUIRE_FALSE(node.is_marked_to_delete());
+
+        // subtree is visible as long as any of its nodes is visible
+        auto tmp_child = kaacore::make_node();
+        tmp_child->shape(kaacore::Shape::Box({10., 10.}));
+        tmp_child->position(scene.camera().position());
+        container->add_child(tmp_child);
+        process_frame();
+        REQUIRE_FALSE(node->is_offscreen_paused());
+        REQUIRE(node->lifetime().count() == Approx(0.04));
+        process_frame();
+        REQUIRE(node.is_marked_to_delete());
+    }
+
+    SECTION("Nodes added after processing queue was built")
+    {
+        container->offscreen_update_policy(
+            kaacore::OffscreenUpdatePolicy::pause_drawing
+        );
+        auto& processing_queue = scene.build_processing_queue();
+        // preorder positions of the following nodes are shifted
+        auto tmp_child = kaacore::make_node();
+        tmp_child->shape(kaacore::Shape::Box({10., 10.}));
+        tmp_child->position(far_position);
+        container->add_child(tmp_child);
+        scene.update_nodes_drawing_queue(processing_queue);
+        REQUIRE(container->is_offscreen_paused());
+        REQUIRE(node->is_offscreen_paused());
+        REQUIRE_FALSE(visible_node->is_offscreen_paused());
+    }
+
+    SECTION("Visible node moved off-screen")
+    {
+        const auto draw_units_count = [&scene](const kaacore::NodePtr node) {
+            scene.draw_queue.process_modifications();
+            size_t count = 0;
+            for (const auto& [key, bucket] : scene.draw_queue) {
+                for (const auto& draw_unit : bucket.draw_units) {
+                    count += draw_unit.id == node->scene_tree_id();
+                }
+            }
+            return count;
+        };
+
+        visible_node->offscreen_update_policy(
+            kaacore::OffscreenUpdatePolicy::pause_drawing
+        );
+        process_frame();
+        REQUIRE_FALSE(visible_node->is_offscreen_paused());
+        REQUIRE(draw_units_count(visible_node) == 1);
+
+        // draw unit is not left at the last visible position
+        visible_node->position(far_position);
+        process_frame();
+        REQUIRE(visible_node->is_offscreen_paused());
+        REQUIRE(draw_units_count(visible_node) == 0);
+        process_frame();
+        REQUIRE(draw_units_count(visible_node) == 0);
+
+        visible_node->position(scene.camera().position());
+        process_frame();
+        REQUIRE_FALSE(visible_node->is_offscreen_paused());
+        REQUIRE(draw_units_count(visible_node) == 1);
+    }
+    scene.remove_marked_nodes();
+}
+
+TEST_CASE("test_nodes_groups", "[nodes][groups]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_container = kaacore::make_node();
+    tmp_container->add_tag("enemies");
+    auto container = scene.root_node.add_child(tmp_container);
+    std::vector<kaacore::NodePtr> enemies;
+    for (size_t i = 0; i < 5; i++) {
+        auto tmp_node = kaacore::make_node();
+        tmp_node->add_tag("enemies");
+        if (i % 2 == 0) {
+            tmp_node->add_tag("flying");
+        }
+        enemies.push_back(container->add_child(tmp_node));
+    }
+    auto tmp_projectile = kaacore::make_node();
+    tmp_projectile->add_tag("projectiles");
+    auto projectile = scene.root_node.add_child(tmp_projectile);
+
+    REQUIRE(scene.group_size("enemies") == 6);
+    REQUIRE(scene.group_size("flying") == 3);
+    REQUIRE(scene.group_size("projectiles") == 1);
+    REQUIRE(scene.group_size("missing") == 0);
+    REQUIRE(scene.group("projectiles")[0] == projectile.get());
+    REQUIRE(enemies[0]->has_tag("flying"));
+    REQUIRE(
+        enemies[0]->tags() == std::vector<std::string>{"enemies", "flying"}
+    );
+
+    SECTION("Tags changes")
+    {
+        enemies[0]->remove_tag("flying");
+        enemies[1]->add_tag("flying");
+        enemies[1]->add_tag("flying");
+        REQUIRE(scene.group_size("flying") == 3);
+        REQUIRE_FALSE(enemies[0]->has_tag("flying"));
+        const auto& flying = scene.group("flying");
+        REQUIRE(
+            std::find(flying.begin(), flying.end(), enemies[1].get()) !=
+            flying.end()
+        );
+        REQUIRE(
+            std::find(flying.begin(), flying.end(), enemies[0].get()) ==
+            flying.end()
+        );
+    }
+
+    SECTION("Group bulk operations")
+    {
+        scene.set_group_visible("flying", false);
+        scene.set_group_z_index("enemies", 5);
+        REQUIRE_FALSE(enemies[0]->visible());
+        REQUIRE(enemies[1]->visible());
+        REQUIRE(enemies[3]->z_index() == 5);
+        REQUIRE(container->z_index() == 5);
+        REQUIRE(projectile->z_index() == std::nullopt);
+    }
+
+    SECTION("Removed nodes leave groups")
+    {
+        enemies[2].destroy();
+        REQUIRE(scene.group_size("enemies") == 5);
+        REQUIRE(scene.group_size("flying") == 2);
+
+        scene.delete_group("enemies");
+        REQUIRE(scene.group_size("enemies") == 0);
+        REQUIRE(scene.group_size("flying") == 0);
+        REQUIRE(scene.group_size("projectiles") == 1);
+        REQUIRE(container.is_marked_to_delete());
+    }
+    scene.remove_marked_nodes();
+}
+
+TEST_CASE("test_node_handles", "[nodes][handles]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_node = kaacore::make_node();
+    REQUIRE_THROWS(tmp_node->handle());
+    auto node = scene.root_node.add_child(tmp_node);
+    auto tmp_child = kaacore::make_node();
+    auto child = node->add_child(tmp_child);
+
+    const auto handle = node->handle();
+    const auto child_handle = child->handle();
+    REQUIRE(handle);
+    REQUIRE_FALSE(kaacore::NodeHandle{});
+    REQUIRE(node->handle() == handle);
+    REQUIRE(handle != child_handle);
+    REQUIRE(scene.resolve(handle) == node.get());
+    REQUIRE(scene.resolve(child_handle) == child.get());
+    REQUIRE_FALSE(scene.resolve(kaacore::NodeHandle{}));
+
+    std::unordered_set<kaacore::NodeHandle> handles{handle, child_handle};
+    REQUIRE(handles.count(handle) == 1);
+
+    // handles of removed nodes are stale even before they are freed
+    node.destroy();
+    REQUIRE_FALSE(scene.resolve(handle));
+    REQUIRE_FALSE(scene.resolve(child_handle));
+    scene.remove_marked_nodes();
+
+    // freed slots are reused with new generation
+    auto tmp_other_node = kaacore::make_node();
+    auto other_node = scene.root_node.add_child(tmp_other_node);
+    const auto other_handle = other_node->handle();
+    REQUIRE((other_handle.slot == handle.slot or
+             other_handle.slot == child_handle.slot));
+    REQUIRE(other_handle != handle);
+    REQUIRE(other_handle != child_handle);
+    REQUIRE_FALSE(scene.resolve(handle));
+    REQUIRE_FALSE(scene.resolve(child_handle));
+    REQUIRE(scene.resolve(other_handle) == other_node.get());
+}
+
+TEST_CASE("test_nodes_batch", "[nodes][batch]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    std::vector<kaacore::NodePtr> nodes;
+    std::vector<kaacore::NodePtr> children;
+    std::vector<kaacore::NodeHandle> handles;
+    for (size_t i = 0; i < 10; i++) {
+        auto tmp_node = kaacore::make_node();
+        auto node = scene.root_node.add_child(tmp_node);
+        auto tmp_child = kaacore::make_node();
+        tmp_child->position({1., 1.});
+        children.push_back(node->add_child(tmp_child));
+        nodes.push_back(node);
+        handles.push_back(node->handle());
+    }
+    // nested node which is a part of the batch as well
+    handles.push_back(children[0]->handle());
+    nodes.push_back(children[0]);
+
+    for (auto& child : children) {
+        child->absolute_position();
+        REQUIRE_FALSE(
+            child->query_dirty_flags(kaacore::Node::DIRTY_MODEL_MATRIX)
+        );
+    }
+
+    kaacore::NodesBatch batch{scene, handles};
+    REQUIRE(batch.size() == handles.size());
+
+    std::vector<glm::dvec2> positions;
+    for (size_t i = 0; i < batch.size(); i++) {
+        positions.push_back({i * 10., 0.});
+    }
+    batch.positions(positions);
+    REQUIRE(batch.positions() == positions);
+    for (size_t i = 1; i < 10; i++) {
+        REQUIRE(
+            children[i]->query_dirty_flags(kaacore::Node::DIRTY_MODEL_MATRIX)
+        );
+        REQUIRE(children[i]->absolute_position().x == Approx(i * 10. + 1.));
+    }
+    REQUIRE(children[0]->absolute_position().x == Approx(100.));
+
+    std::vector<bool> visible(batch.size(), true);
+    visible[3] = false;
+    batch.visible(visible);
+    REQUIRE(batch.visible() == visible);
+    REQUIRE_FALSE(nodes[3]->visible());
+
+    std::vector<std::optional<int16_t>> z_indices(batch.size(), 4);
+    batch.z_indices(z_indices);
+    REQUIRE(nodes[5]->z_index() == 4);
+    REQUIRE(children[5]->effective_z_index() == 4);
+
+    batch.colors(std::vector<glm::dvec4>(batch.size(), {1., 0., 0., 1.}));
+    batch.rotations(std::vector<double>(batch.size(), 0.5));
+    batch.scales(std::vector<glm::dvec2>(batch.size(), {2., 2.}));
+    REQUIRE(nodes[7]->color() == glm::dvec4{1., 0., 0., 1.});
+    REQUIRE(nodes[7]->rotation() == Approx(0.5));
+    REQUIRE(nodes[7]->scale() == glm::dvec2{2., 2.});
+
+    REQUIRE_THROWS(batch.positions({{0., 0.}}));
+    nodes[9].destroy();
+    REQUIRE_THROWS(batch.positions());
+    scene.remove_marked_nodes();
+}
+
+TEST_CASE("test_prepared_subtree_attach", "[nodes][prepare]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    kaacore::NodeOwnerPtr subtree;
+    std::thread worker{[&subtree]() {
+        subtree = kaacore::make_node();
+        for (size_t i = 0; i < 100; i++) {
+            auto tmp_node = kaacore::make_node();
+            tmp_node->shape(kaacore::Shape::Box({2., 2.}));
+            tmp_node->position({i * 4., 0.});
+            auto node = subtree->add_child(tmp_node);
+            auto child = kaacore::make_node();
+            child->shape(kaacore::Shape::Circle(1.));
+            node->add_child(child);
+        }
+        auto tilemap = kaacore::make_node(kaacore::NodeType::tilemap);
+        tilemap->tilemap.chunk_size(8);
+        tilemap->tilemap.fill({0, 0}, {15, 15}, 1);
+        subtree->add_child(tilemap);
+        subtree->prepare_subtree();
+    }};
+    worker.join();
+
+    auto tilemap = subtree->children().back();
+    REQUIRE(tilemap->tilemap.dirty_chunks_count() == 0);
+    REQUIRE_THROWS(tilemap->prepare_subtree());
+    REQUIRE(subtree->scene() == nullptr);
+
+    auto root = scene.root_node.add_child(subtree);
+    std::vector<uint64_t> scene_tree_ids;
+    root->recursive_call_downstream([&](kaacore::Node* node) {
+        REQUIRE(node->scene() == &scene);
+        REQUIRE(node->root_distance() == node->parent()->root_distance() + 1);
+        scene_tree_ids.push_back(node->scene_tree_id());
+    });
+    // tilemap chunks are included
+    REQUIRE(scene_tree_ids.size() == 1 + 100 * 2 + 1 + 4);
+    REQUIRE(
+        std::find(scene_tree_ids.begin(), scene_tree_ids.end(), 0u) ==
+        scene_tree_ids.end()
+    );
+    std::sort(scene_tree_ids.begin(), scene_tree_ids.end());
+    REQUIRE(
+        std::adjacent_find(scene_tree_ids.begin(), scene_tree_ids.end()) ==
+        scene_tree_ids.end()
+    );
+    REQUIRE_THROWS(root->prepare_subtree());
+}
+
+TEST_CASE("test_spawn_children", "[nodes][spawn]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    kaacore::NodeTemplate node_template;
+    node_template.shape = kaacore::Shape::Box({2., 2.});
+    node_template.z_index = 5;
+    node_template.color = {1., 0., 0., 1.};
+    node_template.lifetime = 1s;
+    std::vector<kaacore::NodeSpawnTransformation> transformations;
+    for (size_t i = 0; i < 100; i++) {
+        transformations.push_back({{i * 10., 0.}, 0.5, {2., 2.}});
+    }
+
+    auto check_spawned = [&](const std::vector<kaacore::NodePtr>& spawned) {
+        REQUIRE(spawned.size() == transformations.size());
+        for (size_t i = 0; i < spawned.size(); i++) {
+            REQUIRE(spawned[i]->position() == transformations[i].position);
+            REQUIRE(spawned[i]->rotation() == 0.5);
+            REQUIRE(spawned[i]->scale() == glm::dvec2{2., 2.});
+            REQUIRE(spawned[i]->shape() == node_template.shape);
+            REQUIRE(spawned[i]->z_index() == 5);
+            REQUIRE(spawned[i]->color() == node_template.color);
+        }
+    };
+
+    auto container_tmp = kaacore::make_node();
+    auto container = scene.root_node.add_child(container_tmp);
+    auto tmp_node = kaacore::make_node();
+    auto existing = container->add_child(tmp_node);
+
+    SECTION("Spawning in the scene tree")
+    {
+        auto spawned =
+            container->spawn_children(node_template, transformations);
+        check_spawned(spawned);
+        auto children = container->children();
+        REQUIRE(children.size() == transformations.size() + 1);
+        REQUIRE(children.front() == existing.get());
+        for (size_t i = 0; i < spawned.size(); i++) {
+            REQUIRE(children[i + 1] == spawned[i].get());
+            REQUIRE(spawned[i]->scene() == &scene);
+            REQUIRE(spawned[i]->lifetime().count() == Approx(1.));
+        }
+
+        auto& queue = scene.build_processing_queue();
+        REQUIRE(queue.size() == transformations.size() + 3);
+        REQUIRE(queue[1] == container.get());
+        REQUIRE(queue[2] == existing.get());
+        REQUIRE(queue.back() == spawned.back().get());
+
+        spawned[3].destroy();
+        scene.remove_marked_nodes();
+        REQUIRE(container->children().size() == transformations.size());
+    }
+
+    SECTION("Spawning in detached node")
+    {
+        auto detached = kaacore::make_node();
+        auto spawned =
+            detached->spawn_children(node_template, transformations);
+        check_spawned(spawned);
+        REQUIRE(spawned.front()->scene() == nullptr);
+
+        auto attached = container->add_child(detached);
+        REQUIRE(spawned.front()->scene() == &scene);
+        REQUIRE(spawned.back()->lifetime().count() == Approx(1.));
+        REQUIRE(
+            scene.build_processing_queue().size() ==
+            transformations.size() + 4
+        );
+    }
+}
+
+TEST_CASE("benchmark_spawn_children", "[.][benchmark][nodes][spawn]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    kaacore::NodeTemplate node_template;
+    node_template.shape = kaacore::Shape::Box({2., 2.});
+    node_template.indexable = true;
+    std::vector<kaacore::NodeSpawnTransformation> transformations;
+    for (size_t i = 0; i < 50000; i++) {
+        transformations.push_back({{(i % 250) * 4., (i / 250) * 4.}});
+    }
+
+    // both variants include removal of spawned nodes
+    auto run_spawn = [&scene](auto spawn_function) {
+        auto container_tmp = kaacore::make_node();
+        auto container = scene.root_node.add_child(container_tmp);
+        spawn_function(container);
+        container.destroy();
+        scene.remove_marked_nodes();
+    };
+
+    BENCHMARK("50k nodes, make_node + add_child")
+    {
+        run_spawn([&](kaacore::NodePtr container) {
+            for (const auto& transformation : transformations) {
+                auto node = kaacore::make_node();
+                node->shape(node_template.shape);
+                node->indexable(node_template.indexable);
+                node->position(transformation.position);
+                container->add_child(node);
+            }
+        });
+    };
+
+    BENCHMARK("50k nodes, spawn_children")
+    {
+        run_spawn([&](kaacore::NodePtr container) {
+            container->spawn_children(node_template, transformations);
+        });
+    };
+}
+
+TEST_CASE("test_node_cold_data_defaults", "[nodes]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+
+    // getters and resetting setters work without cold data allocated
+    auto node = kaacore::make_node();
+    REQUIRE_FALSE(node->material());
+    REQUIRE(node->transition() == nullptr);
+    REQUIRE_FALSE(node->render_passes().has_value());
+    REQUIRE_FALSE(node->viewports().has_value());
+    REQUIRE(node->wrapper_ptr() == nullptr);
+    node->material({});
+    node->transition(nullptr);
+    node->render_passes(std::nullopt);
+    node->viewports(std::nullopt);
+    REQUIRE_FALSE(node->material());
+    REQUIRE(node->transition() == nullptr);
+    REQUIRE_FALSE(node->render_passes().has_value());
+    REQUIRE_FALSE(node->viewports().has_value());
+
+    node->render_passes(std::unordered_set<int16_t>{1});
+    REQUIRE(*node->render_passes() == std::vector<int16_t>{1});
+    node->render_passes(std::nullopt);
+    REQUIRE_FALSE(node->render_passes().has_value());
+}
+
+TEST_CASE("benchmark_idle_scene_frame", "[.][benchmark][nodes]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    kaacore::NodeTemplate node_template;
+    node_template.shape = kaacore::Shape::Box({2., 2.});
+    std::vector<kaacore::NodeSpawnTransformation> transformations;
+    for (size_t i = 0; i < 200000; i++) {
+        transformations.push_back({{(i % 500) * 4., (i / 500) * 4.}});
+    }
+    scene.root_node.spawn_children(node_template, transformations);
+
+    auto process_frame = [&scene]() {
+        auto& processing_queue = scene.build_processing_queue();
+        scene.update_nodes_drawing_queue(processing_queue);
+        scene.process_nodes(16ms, processing_queue);
+    };
+    process_frame();
+
+    BENCHMARK("200k idle nodes, single frame")
+    {
+        process_frame();
+    };
+}
+
+TEST_CASE("benchmark_nodes_batch", "[.][benchmark][nodes][batch]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    std::vector<kaacore::NodePtr> nodes;
+    std::vector<kaacore::NodeHandle> handles;
+    std::vector<glm::dvec2> positions;
+    for (size_t i = 0; i < 50000; i++) {
+        auto tmp_node = kaacore::make_node();
+        tmp_node->shape(kaacore::Shape::Box({2., 2.}));
+        auto node = scene.root_node.add_child(tmp_node);
+        nodes.push_back(node);
+        handles.push_back(node->handle());
+        positions.push_back({(i % 250) * 4., (i / 250) * 4.});
+    }
+    kaacore::NodesBatch batch{scene, handles};
+
+    double offset = 0.;
+    BENCHMARK("50k nodes, position setter")
+    {
+        offset += 1.;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            nodes[i]->position(positions[i] + offset);
+        }
+    };
+
+    BENCHMARK("50k nodes, batch positions")
+    {
+        offset += 1.;
+        for (auto& position : positions) {
+            position += 1.;
+        }
+        batch.positions(positions);
+    };
+}
@@ -0,0 +1,130 @@
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/nodes.h"
+#include "kaacore/scenes.h"
+
+#include "runner.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("test_particle_emitter_simulation", "[particles][no_engine]")
+{
+    auto node = kaacore::make_node(kaacore::NodeType::particle_emitter);
+    auto& emitter = node->particle_emitter;
+    emitter.seed(1234);
+    REQUIRE(emitter.particles_count() == 0);
+
+    SECTION("Emission rate and lifetime")
+    {
+        emitter.emission_rate(100.);
+        emitter.particle_lifetime(0.95s);
+        for (size_t i = 0; i < 5; i++) {
+            emitter.step(100ms);
+        }
+        REQUIRE(emitter.particles_count() == 50);
+        for (size_t i = 0; i < 20; i++) {
+            emitter.step(100ms);
+            REQUIRE(emitter.particles_count() == 100);
+        }
+
+        emitter.emitting(false);
+        for (size_t i = 0; i < 10; i++) {
+            emitter.step(100ms);
+        }
+        REQUIRE(emitter.particles_count() == 0);
+    }
+
+    SECTION("Movement, color and size over lifetime")
+    {
+        emitter.particle_lifetime(1s);
+        emitter.initial_velocity({10., 0.});
+        emitter.gravity({0., 100.});
+        emitter.start_color({1., 0., 0., 1.});
+        emitter.end_color({0., 0., 1., 0.});
+        emitter.start_size(2.);
+        emitter.end_size(4.);
+        emitter.emit(10);
+        REQUIRE(emitter.particles_count() == 10);
+        REQUIRE(emitter.sizes()[0] == Approx(2.));
+
+        for (size_t i = 0; i < 5; i++) {
+            emitter.step(100ms);
+        }
+        REQUIRE(emitter.particles_count() == 10);
+        for (size_t i = 0; i < emitter.particles_count(); i++) {
+            REQUIRE(emitter.ages()[i] == Approx(0.5));
+            REQUIRE(emitter.velocities()[i].x == Approx(10.));
+            REQUIRE(emitter.velocities()[i].y == Approx(50.));
+            REQUIRE(emitter.positions()[i].x == Approx(5.));
+            REQUIRE(emitter.positions()[i].y == Approx(15.));
+            REQUIRE(emitter.sizes()[i] == Approx(3.));
+            REQUIRE(emitter.colors()[i].r == Approx(0.5));
+            REQUIRE(emitter.colors()[i].b == Approx(0.5));
+            REQUIRE(emitter.colors()[i].a == Approx(0.5));
+        }
+    }
+
+    SECTION("Particles limit")
+    {
+        emitter.emit(5000);
+        REQUIRE(emitter.particles_count() == 1000);
+        emitter.max_particles(10);
+        REQUIRE(emitter.particles_count() == 10);
+        REQUIRE_THROWS(emitter.max_particles(
+            kaacore::max_particles_per_emitter + 1
+        ));
+        emitter.clear();
+        REQUIRE(emitter.particles_count() == 0);
+    }
+
+    SECTION("Vertices buffer")
+    {
+        emitter.velocity_spread({20., 20.});
+        emitter.start_size(2.);
+        emitter.end_size(2.);
+        emitter.emit(100);
+        emitter.step(100ms);
+        node->position({100., 50.});
+        node->recalculate_model_matrix();
+        auto [vertices, indices] = node->recalculate_vertices_indices_data();
+        REQUIRE(vertices.size() == 400);
+        REQUIRE(indices.size() == 600);
+        for (size_t i = 0; i < emitter.particles_count(); i++) {
+            const auto& position = emitter.positions()[i];
+            const auto& first = vertices[i * 4];
+            const auto& third = vertices[i * 4 + 2];
+            REQUIRE(first.xyz.x == Approx(100. + position.x - 1.));
+            REQUIRE(first.xyz.y == Approx(50. + position.y - 1.));
+            REQUIRE(third.xyz.x == Approx(100. + position.x + 1.));
+            REQUIRE(third.xyz.y == Approx(50. + position.y + 1.));
+            REQUIRE(first.uv == glm::fvec2{0., 0.});
+            REQUIRE(third.uv == glm::fvec2{1., 1.});
+        }
+        for (auto index : indices) {
+            REQUIRE(index < vertices.size());
+        }
+    }
+}
+
+TEST_CASE("test_particle_emitter_in_scene", "[particles]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_node = kaacore::make_node(kaacore::NodeType::particle_emitter);
+    auto node = scene.root_node.add_child(tmp_node);
+    node->particle_emitter.emission_rate(1000.);
+
+    scene.process_nodes(100ms, scene.build_processing_queue());
+    REQUIRE(node->particle_emitter.particles_count() == 100);
+    REQUIRE(node->query_dirty_flags(kaacore::Node::DIRTY_DRAW_VERTICES));
+
+    auto mods_pack = node->calculate_draw_unit_updates();
+    REQUIRE(mods_pack.upsert_mod);
+    REQUIRE(mods_pack.upsert_mod->state_update.vertices.size() == 400);
+    REQUIRE(mods_pack.upsert_mod->state_update.indices.size() == 600);
+}
@@ -0,0 +1,115 @@
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/engine.h"
+#include "kaacore/nodes.h"
+#include "kaacore/physics.h"
+#include "kaacore/scenes.h"
+
+#include "runner.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("test_body_nodes_batch", "[physics][batch]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_space = kaacore::make_node(kaacore::NodeType::space);
+    auto space = scene.root_node.add_child(tmp_space);
+    std::vector<kaacore::NodePtr> bodies;
+    std::vector<kaacore::NodeHandle> handles;
+    for (size_t i = 0; i < 10; i++) {
+        auto tmp_body = kaacore::make_node(kaacore::NodeType::body);
+        tmp_body->body.mass(2.);
+        tmp_body->body.moment(10.);
+        auto body = space->add_child(tmp_body);
+        auto hitbox = kaacore::make_node(kaacore::NodeType::hitbox);
+        hitbox->shape(kaacore::Shape::Circle(1.));
+        body->add_child(hitbox);
+        bodies.push_back(body);
+        handles.push_back(body->handle());
+    }
+
+    kaacore::BodyNodesBatch batch{scene, handles};
+    REQUIRE(batch.size() == 10);
+
+    std::vector<glm::dvec2> positions;
+    std::vector<glm::dvec2> velocities;
+    std::vector<double> angular_velocities;
+    for (size_t i = 0; i < batch.size(); i++) {
+        positions.push_back({i * 10., 0.});
+        velocities.push_back({0., i * 1.});
+        angular_velocities.push_back(i * 0.1);
+    }
+    batch.positions(positions);
+    batch.velocities(velocities);
+    batch.angular_velocities(angular_velocities);
+    batch.forces(std::vector<glm::dvec2>(batch.size(), {1., 0.}));
+
+    REQUIRE(batch.positions() == positions);
+    REQUIRE(batch.velocities() == velocities);
+    REQUIRE(batch.angular_velocities() == angular_velocities);
+    REQUIRE(bodies[3]->position() == positions[3]);
+    REQUIRE(bodies[3]->body.velocity() == velocities[3]);
+    REQUIRE(bodies[3]->body.angular_velocity() == angular_velocities[3]);
+    REQUIRE(bodies[3]->body.force() == glm::dvec2{1., 0.});
+    REQUIRE(bodies[3]->query_dirty_flags(kaacore::Node::DIRTY_MODEL_MATRIX));
+
+    batch.forces(std::vector<glm::dvec2>(batch.size(), {0., 0.}));
+    batch.apply_impulses(std::vector<glm::dvec2>(batch.size(), {1., 0.}));
+    REQUIRE(bodies[5]->body.velocity().x == Approx(0.5));
+    REQUIRE(bodies[5]->body.velocity().y == Approx(velocities[5].y));
+    REQUIRE(bodies[5]->body.angular_velocity() == Approx(0.5));
+    REQUIRE(batch.sleeping() == std::vector<bool>(batch.size(), false));
+
+    REQUIRE_THROWS(batch.velocities({{0., 0.}}));
+    REQUIRE_THROWS(
+        kaacore::BodyNodesBatch{scene, {space->handle()}}.velocities()
+    );
+    bodies[9].destroy();
+    REQUIRE_THROWS(batch.velocities());
+    scene.remove_marked_nodes();
+}
+
+TEST_CASE("benchmark_body_nodes_batch", "[.][benchmark][physics][batch]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_space = kaacore::make_node(kaacore::NodeType::space);
+    auto space = scene.root_node.add_child(tmp_space);
+    std::vector<kaacore::NodePtr> bodies;
+    std::vector<kaacore::NodeHandle> handles;
+    std::vector<glm::dvec2> velocities;
+    for (size_t i = 0; i < 20000; i++) {
+        auto tmp_body = kaacore::make_node(kaacore::NodeType::body);
+        tmp_body->position({(i % 200) * 4., (i / 200) * 4.});
+        auto body = space->add_child(tmp_body);
+        bodies.push_back(body);
+        handles.push_back(body->handle());
+        velocities.push_back({(i % 7) * 1., (i % 11) * 1.});
+    }
+    kaacore::BodyNodesBatch batch{scene, handles};
+
+    BENCHMARK("20k bodies, velocity setter")
+    {
+        for (size_t i = 0; i < bodies.size(); i++) {
+            bodies[i]->body.velocity(velocities[i]);
+        }
+    };
+
+    BENCHMARK("20k bodies, batch velocities")
+    {
+        batch.velocities(velocities);
+    };
+
+    BENCHMARK("20k bodies, batch velocities read")
+    {
+        return batch.velocities();
+    };
+}
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/exceptions.h"
+#include "kaacore/nodes.h"
+#include "kaacore/physics.h"
+#include "kaacore/serialization.h"
+#include "kaacore/stencil.h"
+
+#include "runner.h"
+
+inline void
+require_same_nodes(kaacore::Node* const node, kaacore::Node* const other)
+{
+    REQUIRE(node->type() == other->type());
+    REQUIRE(node->position() == other->position());
+    REQUIRE(node->rotation() == other->rotation());
+    REQUIRE(node->scale() == other->scale());
+    REQUIRE(node->color() == other->color());
+    REQUIRE(node->z_index() == other->z_index());
+    REQUIRE(node->visible() == other->visible());
+    REQUIRE(node->indexable() == other->indexable());
+    REQUIRE(node->lifetime() == other->lifetime());
+    REQUIRE(node->shape() == other->shape());
+    if (node->type() == kaacore::NodeType::tilemap) {
+        return;
+    }
+
+    const auto children = node->children();
+    const auto other_children = other->children();
+    REQUIRE(children.size() == other_children.size());
+    for (size_t i = 0; i < children.size(); i++) {
+        REQUIRE(other_children[i]->parent() == other);
+        require_same_nodes(children[i], other_children[i]);
+    }
+}
+
+TEST_CASE("test_nodes_snapshot_round_trip", "[serialization][no_engine]")
+{
+    auto root = kaacore::make_node();
+    root->position({10., -20.});
+    root->rotation(0.5);
+    root->scale({2., 3.});
+    root->z_index(3);
+
+    for (size_t i = 0; i < 10; i++) {
+        auto node = kaacore::make_node();
+        node->position({i * 5., 0.});
+        node->shape(kaacore::Shape::Box({2., 2.}));
+        node->color({1., 0., 0., 0.5});
+        node->visible(i % 2 == 0);
+        node->indexable(i % 3 == 0);
+        auto child = kaacore::make_node();
+        child->shape(kaacore::Shape::Circle(3.));
+        node->add_child(child);
+        root->add_child(node);
+    }
+
+    auto emitter = kaacore::make_node(kaacore::NodeType::particle_emitter);
+    emitter->particle_emitter.emission_rate(25.);
+    emitter->particle_emitter.max_particles(500);
+    root->add_child(emitter);
+
+    auto tilemap = kaacore::make_node(kaacore::NodeType::tilemap);
+    tilemap->tilemap.chunk_size(8);
+    tilemap->tilemap.fill({0, 0}, {11, 3}, 1);
+    tilemap->tilemap.tile({-1, -1}, 2);
+    root->add_child(tilemap);
+
+    const auto snapshot = kaacore::serialize_nodes(root.get());
+    auto loaded = kaacore::deserialize_nodes(snapshot.data(), snapshot.size());
+    REQUIRE(loaded->children().size() == root->children().size());
+
+    // tilemap chunks are not stored, they are recreated from tiles
+    const auto loaded_children = loaded->children();
+    auto loaded_tilemap = loaded_children.back();
+    REQUIRE(loaded_tilemap->tilemap.chunks_count() == 3);
+    REQUIRE(loaded_tilemap->tilemap.tile({11, 3}) == 1);
+    REQUIRE(loaded_tilemap->tilemap.tile({12, 3}) == kaacore::empty_tile);
+    REQUIRE(loaded_tilemap->tilemap.tile({-1, -1}) == 2);
+    require_same_nodes(root.get(), loaded.get());
+
+    auto loaded_emitter = loaded_children[loaded_children.size() - 2];
+    REQUIRE(loaded_emitter->particle_emitter.emission_rate() == 25.);
+    REQUIRE(loaded_emitter->particle_emitter.max_particles() == 500);
+
+    SECTION("Invalid snapshots")
+    {
+        REQUIRE_THROWS(kaacore::deserialize_nodes(snapshot.data(), 0));
+        REQUIRE_THROWS(
+            kaacore::deserialize_nodes(snapshot.data(), snapshot.size() - 1)
+        );
+        auto corrupted = snapshot;
+        corrupted[0] = 0;
+        REQUIRE_THROWS(
+            kaacore::deserialize_nodes(corrupted.data(), corrupted.size())
+        );
+    }
+
+    SECTION("Truncated snapshots")
+    {
+        for (size_t size = 0; size < snapshot.size(); size += 7) {
+            REQUIRE_THROWS_AS(
+                kaacore::deserialize_nodes(snapshot.data(), size),
+                kaacore::exception
+            );
+        }
+    }
+
+    SECTION("Multiple roots")
+    {
+        auto single = kaacore::make_node();
+        auto multiple = kaacore::serialize_nodes(single.get());
+        // magic, version, nodes count and textures count come first
+        const size_t nodes_count_offset = sizeof(uint32_t) + sizeof(uint16_t);
+        const size_t header_size = nodes_count_offset + 2 * sizeof(uint32_t);
+        const uint32_t nodes_count = 2;
+        std::memcpy(
+            multiple.data() + nodes_count_offset, &nodes_count,
+            sizeof(nodes_count)
+        );
+        const std::vector<uint8_t> root_data(
+            multiple.begin() + header_size, multiple.end()
+        );
+        multiple.insert(multiple.end(), root_data.begin(), root_data.end());
+        REQUIRE_THROWS_WITH(
+            kaacore::deserialize_nodes(multiple.data(), multiple.size()),
+            Catch::Contains("multiple roots")
+        );
+    }
+
+    SECTION("Loading from file")
+    {
+        const std::string path = "test_nodes_snapshot.kaa";
+        kaacore::save_nodes(root.get(), path);
+        auto loaded_from_file = kaacore::load_nodes(path);
+        std::remove(path.c_str());
+        require_same_nodes(root.get(), loaded_from_file.get());
+    }
+
+    SECTION("Invalid values")
+    {
+        auto single = kaacore::make_node();
+        const auto single_snapshot = kaacore::serialize_nodes(single.get());
+        // magic, version, nodes count and textures count come first
+        const size_t type_offset =
+            sizeof(uint32_t) + sizeof(uint16_t) + 2 * sizeof(uint32_t);
+        const size_t children_count_offset = type_offset + 2;
+        const size_t alignment_offset = children_count_offset +
+                                        sizeof(uint32_t) +
+                                        2 * sizeof(glm::dvec2) +
+                                        sizeof(double) + sizeof(glm::dvec4);
+        REQUIRE_NOTHROW(kaacore::deserialize_nodes(
+            single_snapshot.data(), single_snapshot.size()
+        ));
+
+        for (const auto [offset, value] :
+             {std::pair<size_t, uint8_t>{type_offset, 0xff},
+              {children_count_offset + 3, 0xff},
+              {alignment_offset, 0xff},
+              {alignment_offset, 0b0011}}) {
+            auto corrupted = single_snapshot;
+            corrupted[offset] = value;
+            REQUIRE_THROWS_AS(
+                kaacore::deserialize_nodes(corrupted.data(), corrupted.size()),
+                kaacore::exception
+            );
+        }
+    }
+}
+
+inline size_t
+find_difference_offset(
+    const std::vector<uint8_t>& snapshot, const std::vector<uint8_t>& other
+)
+{
+    REQUIRE(snapshot.size() == other.size());
+    const auto [it, other_it] =
+        std::mismatch(snapshot.begin(), snapshot.end(), other.begin());
+    REQUIRE(it != snapshot.end());
+    return it - snapshot.begin();
+}
+
+TEST_CASE("test_nodes_snapshot_node_data", "[serialization]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+
+    SECTION("Render passes, viewports and stencil mode")
+    {
+        auto node = kaacore::make_node();
+        node->render_passes(std::unordered_set<int16_t>{0, 2, 5});
+        node->viewports(std::unordered_set<int16_t>{1, 31});
+        const kaacore::StencilMode stencil_mode{
+            3, 0xf0, kaacore::StencilTest::greater_equal,
+            kaacore::StencilOp::replace, kaacore::StencilOp::zero,
+            kaacore::StencilOp::invert
+        };
+        node->stencil_mode(stencil_mode);
+
+        const auto snapshot = kaacore::serialize_nodes(node.get());
+        auto loaded =
+            kaacore::deserialize_nodes(snapshot.data(), snapshot.size());
+        auto render_passes = *loaded->render_passes();
+        std::sort(render_passes.begin(), render_passes.end());
+        REQUIRE(render_passes == std::vector<int16_t>{0, 2, 5});
+        auto viewports = *loaded->viewports();
+        std::sort(viewports.begin(), viewports.end());
+        REQUIRE(viewports == std::vector<int16_t>{1, 31});
+        REQUIRE(*loaded->stencil_mode() == stencil_mode);
+
+        // locate stencil test and pass op by changing them
+        auto other_stencil_mode = stencil_mode;
+        other_stencil_mode.test(kaacore::StencilTest::less);
+        node->stencil_mode(other_stencil_mode);
+        const size_t test_offset = find_difference_offset(
+            snapshot, kaacore::serialize_nodes(node.get())
+        );
+        other_stencil_mode = stencil_mode;
+        other_stencil_mode.pass_op(kaacore::StencilOp::keep);
+        node->stencil_mode(other_stencil_mode);
+        const size_t pass_op_offset = find_difference_offset(
+            snapshot, kaacore::serialize_nodes(node.get())
+        );
+
+        for (const auto offset : {test_offset, pass_op_offset}) {
+            auto corrupted = snapshot;
+            corrupted[offset] = 0xff;
+            REQUIRE_THROWS_WITH(
+                kaacore::deserialize_nodes(corrupted.data(), corrupted.size()),
+                Catch::Contains("Invalid stencil")
+            );
+        }
+    }
+
+    SECTION("Body and hitbox")
+    {
+        auto body = kaacore::make_node(kaacore::NodeType::body);
+        body->body.mass(3.);
+        body->body.moment(7.);
+        body->body.velocity({4., -2.});
+        body->body.angular_velocity(0.5);
+        auto hitbox = kaacore::make_node(kaacore::NodeType::hitbox);
+        hitbox->shape(kaacore::Shape::Circle(2.));
+        hitbox->hitbox.trigger_id(12);
+        hitbox->hitbox.group(3);
+        hitbox->hitbox.mask(0b0101);
+        hitbox->hitbox.collision_mask(0b1010);
+        hitbox->hitbox.sensor(true);
+        hitbox->hitbox.elasticity(0.25);
+        hitbox->hitbox.friction(0.75);
+        hitbox->hitbox.surface_velocity({1., 1.});
+        body->add_child(hitbox);
+
+        const auto snapshot = kaacore::serialize_nodes(body.get());
+        auto loaded =
+            kaacore::deserialize_nodes(snapshot.data(), snapshot.size());
+        require_same_nodes(body.get(), loaded.get());
+        REQUIRE(loaded->body.body_type() == kaacore::BodyNodeType::dynamic);
+        REQUIRE(loaded->body.mass() == 3.);
+        REQUIRE(loaded->body.moment() == 7.);
+        REQUIRE(loaded->body.velocity() == glm::dvec2{4., -2.});
+        REQUIRE(loaded->body.angular_velocity() == 0.5);
+        auto& loaded_hitbox = loaded->children()[0]->hitbox;
+        REQUIRE(loaded_hitbox.trigger_id() == 12);
+        REQUIRE(loaded_hitbox.group() == 3);
+        REQUIRE(loaded_hitbox.mask() == 0b0101);
+        REQUIRE(loaded_hitbox.collision_mask() == 0b1010);
+        REQUIRE(loaded_hitbox.sensor());
+        REQUIRE(loaded_hitbox.elasticity() == 0.25);
+        REQUIRE(loaded_hitbox.friction() == 0.75);
+        REQUIRE(loaded_hitbox.surface_velocity() == glm::dvec2{1., 1.});
+
+        // mass properties are skipped for non-dynamic bodies
+        auto kinematic_body = kaacore::make_node(kaacore::NodeType::body);
+        kinematic_body->body.body_type(kaacore::BodyNodeType::kinematic);
+        kinematic_body->body.velocity({4., -2.});
+        const auto kinematic_snapshot =
+            kaacore::serialize_nodes(kinematic_body.get());
+        auto loaded_kinematic = kaacore::deserialize_nodes(
+            kinematic_snapshot.data(), kinematic_snapshot.size()
+        );
+        REQUIRE(
+            loaded_kinematic->body.body_type() ==
+            kaacore::BodyNodeType::kinematic
+        );
+        REQUIRE(loaded_kinematic->body.velocity() == glm::dvec2{4., -2.});
+
+        // locate body type by changing it
+        kinematic_body->body.body_type(kaacore::BodyNodeType::static_);
+        const size_t body_type_offset = find_difference_offset(
+            kinematic_snapshot, kaacore::serialize_nodes(kinematic_body.get())
+        );
+        auto corrupted = kinematic_snapshot;
+        corrupted[body_type_offset] = 0xff;
+        REQUIRE_THROWS_WITH(
+            kaacore::deserialize_nodes(corrupted.data(), corrupted.size()),
+            Catch::Contains("Invalid body type")
+        );
+    }
+}
+
+TEST_CASE(
+    "benchmark_nodes_snapshot_load", "[.][benchmark][serialization][no_engine]"
+)
+{
+    auto root = kaacore::make_node();
+    for (size_t i = 0; i < 50000; i++) {
+        auto node = kaacore::make_node();
+        node->position({(i % 250) * 4., (i / 250) * 4.});
+        node->shape(kaacore::Shape::Box({2., 2.}));
+        root->add_child(node);
+    }
+    const auto snapshot = kaacore::serialize_nodes(root.get());
+
+    BENCHMARK("50k nodes, serialize_nodes")
+    {
+        return kaacore::serialize_nodes(root.get());
+    };
+
+    BENCHMARK("50k nodes, deserialize_nodes")
+    {
+        return kaacore::deserialize_nodes(snapshot.data(), snapshot.size());
+    };
+}
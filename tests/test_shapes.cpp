@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #include <catch2/catch.hpp>
 #include <glm/glm.hpp>
 
+#include "kaacore/camera.h"
+#include "kaacore/engine.h"
 #include "kaacore/geometry.h"
+#include "kaacore/nodes.h"
+#include "kaacore/renderer.h"
 #include "kaacore/shapes.h"
 
+#include "runner.h"
+
 TEST_CASE("Test circle transformation", "[shapes][no_engine]")
 {
     auto circle_shape = kaacore::Shape::Circle(10.);
@@ -28,3 +38,235 @@ TEST_CASE("Test circle transformation", "[shapes][no_engine]")
         );
     }
 }
+
+TEST_CASE("Test circle tessellation", "[shapes][no_engine]")
+{
+    SECTION("Segments count within error bound")
+    {
+        for (double radius : {0.1, 1., 5., 20., 100., 1000., 10000.}) {
+            const auto segments_count = kaacore::circle_segments_count(radius);
+            REQUIRE(segments_count >= kaacore::min_circle_segments_count);
+            REQUIRE(segments_count <= kaacore::max_circle_segments_count);
+            if (segments_count < kaacore::max_circle_segments_count) {
+                REQUIRE(
+                    kaacore::circle_radial_error(radius, segments_count) <=
+                    kaacore::default_circle_max_radial_error
+                );
+            }
+
+            // distance from the middle of every edge to the circle
+            // doesn't exceed the expected radial error
+            auto shape = kaacore::Shape::AdaptiveCircle(radius, {3., -4.});
+            REQUIRE(shape.bounding_points.size() == segments_count);
+            const auto expected_error =
+                kaacore::circle_radial_error(radius, segments_count);
+            for (size_t i = 0; i < segments_count; i++) {
+                const auto& a = shape.bounding_points[i];
+                const auto& b =
+                    shape.bounding_points[(i + 1) % segments_count];
+                REQUIRE(
+                    glm::distance(a, glm::dvec2{3., -4.}) ==
+                    Approx(radius).epsilon(1e-9)
+                );
+                const double error =
+                    radius - glm::distance((a + b) * 0.5, glm::dvec2{3., -4.});
+                REQUIRE(error == Approx(expected_error).margin(1e-9));
+            }
+        }
+
+        REQUIRE(
+            kaacore::circle_segments_count(1000.) >
+            kaacore::circle_segments_count(10.)
+        );
+        REQUIRE(
+            kaacore::circle_segments_count(1., 0.01) >
+            kaacore::circle_segments_count(1., 0.1)
+        );
+        REQUIRE(
+            kaacore::circle_segments_count(1e9) ==
+            kaacore::max_circle_segments_count
+        );
+    }
+
+    SECTION("Default segments count")
+    {
+        for (double radius : {0.1, 10., 10000.}) {
+            REQUIRE(
+                kaacore::Shape::Circle(radius).bounding_points.size() ==
+                kaacore::default_circle_segments_count
+            );
+        }
+        REQUIRE(
+            kaacore::Shape::AdaptiveCircle(10., {0., 0.}, 0.01)
+                .bounding_points.size() ==
+            kaacore::circle_segments_count(10., 0.01)
+        );
+    }
+
+    SECTION("Explicit segments count")
+    {
+        auto circle_shape = kaacore::Shape::Circle(10., {0., 0.}, 16);
+        REQUIRE(circle_shape.bounding_points.size() == 16);
+        REQUIRE(circle_shape.vertices.size() == 4);
+        REQUIRE(circle_shape.contains_point({9.5, 0.}));
+        REQUIRE_FALSE(circle_shape.contains_point({10.5, 0.}));
+        REQUIRE_THROWS(kaacore::Shape::Circle(10., {0., 0.}, 2));
+
+        auto ellipse_shape = kaacore::Shape::Ellipse({20., 10.}, {0., 0.}, 32);
+        REQUIRE(ellipse_shape.type == kaacore::ShapeType::polygon);
+        REQUIRE(ellipse_shape.points.size() == 32);
+        REQUIRE(ellipse_shape.vertices.size() == 33);
+        REQUIRE(ellipse_shape.indices.size() == 32 * 3);
+        REQUIRE(ellipse_shape.bounding_box().max_x == Approx(20.));
+        REQUIRE(ellipse_shape.bounding_box().max_y == Approx(10.));
+    }
+}
+
+TEST_CASE("Test circle tessellation under camera", "[shapes]")
+{
+    auto engine = initialize_testing_engine();
+    kaacore::Camera camera;
+    const auto segments_count =
+        kaacore::Shape::Circle(10., {0., 0.}, camera).bounding_points.size();
+    camera.scale({8., 8.});
+    const auto scaled_segments_count =
+        kaacore::Shape::Circle(10., {0., 0.}, camera).bounding_points.size();
+    REQUIRE(scaled_segments_count > segments_count);
+
+    const glm::dvec2 view_scale =
+        glm::dvec2(engine->renderer->view_size) /
+        glm::dvec2(engine->virtual_resolution());
+    REQUIRE(
+        scaled_segments_count ==
+        kaacore::circle_segments_count(
+            80. * std::max(view_scale.x, view_scale.y)
+        )
+    );
+}
+
+TEST_CASE("Test circle points built concurrently", "[shapes][no_engine]")
+{
+    const auto expected = kaacore::Shape::Circle(1., {0., 0.}, 7);
+    std::vector<std::thread> threads;
+    std::vector<char> results(4, true);
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&results, i]() {
+            for (uint32_t count = 3; count <= 512; count++) {
+                auto shape = kaacore::Shape::Circle(1., {0., 0.}, count);
+                if (shape.bounding_points.size() != count) {
+                    results[i] = false;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(std::all_of(results.begin(), results.end(), [](char r) {
+        return r;
+    }));
+    const auto circle_shape = kaacore::Shape::Circle(1., {0., 0.}, 7);
+    REQUIRE(circle_shape.bounding_points == expected.bounding_points);
+}
+
+TEST_CASE("Test shapes interning", "[shapes][no_engine]")
+{
+    const size_t initial_count = kaacore::interned_shapes_count();
+    {
+        auto shape = kaacore::intern_shape(kaacore::Shape::Box({3., 7.}));
+        auto same_shape = kaacore::intern_shape(kaacore::Shape::Box({3., 7.}));
+        auto other_shape =
+            kaacore::intern_shape(kaacore::Shape::Box({7., 3.}));
+        REQUIRE(shape == same_shape);
+        REQUIRE(shape != other_shape);
+        REQUIRE(kaacore::interned_shapes_count() == initial_count + 2);
+
+        // circles differing only by tessellation are separate shapes
+        REQUIRE(
+            kaacore::intern_shape(kaacore::Shape::Circle(5., {0., 0.}, 16)) !=
+            kaacore::intern_shape(kaacore::Shape::Circle(5., {0., 0.}, 32))
+        );
+        REQUIRE(
+            kaacore::intern_shape(kaacore::Shape{}) ==
+            kaacore::empty_shape_handle()
+        );
+
+        std::vector<kaacore::NodeOwnerPtr> nodes;
+        for (size_t i = 0; i < 1000; i++) {
+            nodes.push_back(kaacore::make_node());
+            nodes.back()->shape(kaacore::Shape::Box({3., 7.}));
+        }
+        REQUIRE(nodes.front()->shape_handle() == shape);
+        REQUIRE(nodes.back()->shape_handle() == shape);
+        REQUIRE(shape.use_count() == 1000 + 2);
+        REQUIRE(kaacore::interned_shapes_count() == initial_count + 2);
+
+        nodes.back()->shape(kaacore::Shape{});
+        REQUIRE(
+            nodes.back()->shape_handle() == kaacore::empty_shape_handle()
+        );
+    }
+    // shapes are released with their last handle
+    REQUIRE(kaacore::interned_shapes_count() == initial_count);
+
+    // handles released concurrently with interning of the same shape
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 2000; j++) {
+                kaacore::intern_shape(kaacore::Shape::Box({1., j % 3 + 1.}));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(kaacore::interned_shapes_count() == initial_count);
+}
+
+TEST_CASE("Test freeform shapes with geometry buffer", "[shapes][no_engine]")
+{
+    auto geometry = std::make_shared<kaacore::GeometryBuffer>();
+    geometry->vertices = {
+        {-1., -1.}, {1., -1.}, {1., 1.}, {-1., 1.}
+    };
+    geometry->indices = {0, 1, 2, 0, 2, 3};
+
+    const auto shape = kaacore::Shape::Freeform(geometry);
+    REQUIRE(shape.type == kaacore::ShapeType::freeform);
+    REQUIRE(shape.vertices.empty());
+    REQUIRE(shape.get_vertices().data() == geometry->vertices.data());
+    REQUIRE(shape.get_indices() == geometry->indices);
+    REQUIRE(shape.bounding_box().min_x == Approx(-1.));
+    REQUIRE(shape.bounding_box().max_y == Approx(1.));
+
+    // shapes are interned by referenced buffer, not its content
+    auto other_geometry = std::make_shared<kaacore::GeometryBuffer>(*geometry);
+    REQUIRE(
+        kaacore::intern_shape(shape) ==
+        kaacore::intern_shape(kaacore::Shape::Freeform(geometry))
+    );
+    REQUIRE(
+        kaacore::intern_shape(shape) !=
+        kaacore::intern_shape(kaacore::Shape::Freeform(other_geometry))
+    );
+
+    // transformed shape gets its own copy of vertices
+    const auto transformed_shape =
+        shape.transform(kaacore::Transformation::translate({10., 0.}));
+    REQUIRE(transformed_shape.geometry == nullptr);
+    REQUIRE(transformed_shape.vertices[0].xyz.x == Approx(9.));
+    REQUIRE(geometry->vertices[0].xyz.x == Approx(-1.));
+
+    auto node = kaacore::make_node();
+    REQUIRE_THROWS(node->geometry_changed());
+    node->shape(kaacore::Shape::Freeform(geometry, {-5., -5., 5., 5.}));
+    node->clear_dirty_flags(kaacore::Node::DIRTY_DRAW_VERTICES);
+    geometry->vertices[2].xyz = {3., 3., 0.};
+    node->geometry_changed();
+    REQUIRE(node->query_dirty_flags(kaacore::Node::DIRTY_DRAW_VERTICES));
+    const auto [vertices, indices] = node->recalculate_vertices_indices_data();
+    REQUIRE(vertices.size() == 4);
+    REQUIRE(vertices[2].xyz.x == Approx(3.));
+    REQUIRE(indices == geometry->indices);
+}
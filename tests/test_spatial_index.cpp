@@ -0,0 +1,505 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/engine.h"
+#include "kaacore/geometry.h"
+#include "kaacore/nodes.h"
+#include "kaacore/scenes.h"
+#include "kaacore/shapes.h"
+#include "kaacore/spatial_index.h"
+
+#include "runner.h"
+
+using NodesSet = std::set<kaacore::Node*>;
+
+NodesSet
+to_nodes_set(const std::vector<kaacore::NodePtr>& nodes)
+{
+    NodesSet result;
+    for (const auto& node : nodes) {
+        result.insert(node.get());
+    }
+    return result;
+}
+
+const std::vector<
+    std::pair<std::string, std::function<void(kaacore::SpatialIndex&)>>>
+    spatial_index_backends = {
+        {"bb_tree", [](auto& index) { index.use_bb_tree(); }},
+        {"spatial_hash", [](auto& index) { index.use_spatial_hash(16.); }},
+        {"sweep_and_prune", [](auto& index) { index.use_sweep_and_prune(); }},
+};
+
+TEST_CASE("test_spatial_index_backends", "[spatial_index]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    std::mt19937 random_engine{42};
+    std::uniform_real_distribution<double> coord_dist{0., 1000.};
+    std::uniform_real_distribution<double> size_dist{1., 30.};
+    std::vector<kaacore::NodePtr> nodes;
+    for (int i = 0; i < 400; i++) {
+        auto node = kaacore::make_node();
+        node->shape(kaacore::Shape::Box(
+            {size_dist(random_engine), size_dist(random_engine)}
+        ));
+        node->position({coord_dist(random_engine), coord_dist(random_engine)});
+        node->indexable(true);
+        nodes.push_back(scene.root_node.add_child(node));
+    }
+
+    const auto check_queries = [&]() {
+        for (int i = 0; i < 50; i++) {
+            const glm::dvec2 corner = {
+                coord_dist(random_engine), coord_dist(random_engine)
+            };
+            const kaacore::BoundingBox<double> bbox{
+                corner.x, corner.y, corner.x + size_dist(random_engine) * 3,
+                corner.y + size_dist(random_engine) * 3
+            };
+            NodesSet expected_in_bbox;
+            NodesSet expected_at_point;
+            for (const auto& node : nodes) {
+                const auto node_bbox = node->bounding_box();
+                if (node_bbox.intersects(bbox)) {
+                    expected_in_bbox.insert(node.get());
+                }
+                if (node_bbox.contains(corner)) {
+                    expected_at_point.insert(node.get());
+                }
+            }
+            REQUIRE(
+                to_nodes_set(scene.spatial_index.query_bounding_box(bbox)) ==
+                expected_in_bbox
+            );
+            REQUIRE(
+                to_nodes_set(scene.spatial_index.query_point(corner)) ==
+                expected_at_point
+            );
+        }
+    };
+
+    for (const auto& [name, use_backend] : spatial_index_backends) {
+        SECTION(name)
+        {
+            use_backend(scene.spatial_index);
+            scene.resolve_spatial_index_changes(scene.build_processing_queue());
+            check_queries();
+
+            for (size_t i = 0; i < nodes.size(); i += 2) {
+                nodes[i]->position(
+                    {coord_dist(random_engine), coord_dist(random_engine)}
+                );
+            }
+            nodes.back().destroy();
+            nodes.pop_back();
+            scene.remove_marked_nodes();
+            scene.resolve_spatial_index_changes(scene.build_processing_queue());
+            check_queries();
+
+            // node moved outside of its previously indexed bounds
+            nodes.front()->position({5000., 5000.});
+            scene.resolve_spatial_index_changes(scene.build_processing_queue());
+            REQUIRE(
+                to_nodes_set(scene.spatial_index.query_point({5000., 5000.})) ==
+                NodesSet{nodes.front().get()}
+            );
+            nodes.front()->position({500., 500.});
+            scene.resolve_spatial_index_changes(scene.build_processing_queue());
+
+            // switching backends keeps the indexed nodes
+            for (const auto& [_, other_backend] : spatial_index_backends) {
+                other_backend(scene.spatial_index);
+                check_queries();
+            }
+        }
+    }
+
+    scene.spatial_index.use_spatial_hash(50.);
+    REQUIRE(
+        scene.spatial_index.backend() ==
+        kaacore::SpatialIndexBackend::spatial_hash
+    );
+    REQUIRE_THROWS_AS(
+        scene.spatial_index.use_spatial_hash(0.), kaacore::exception
+    );
+}
+
+TEST_CASE("test_spatial_index_spawned_batch", "[spatial_index]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    for (const auto& [name, use_backend] : spatial_index_backends) {
+        SECTION(name)
+        {
+            use_backend(scene.spatial_index);
+            kaacore::NodeTemplate node_template;
+            node_template.shape = kaacore::Shape::Box({2., 2.});
+            node_template.indexable = true;
+            std::vector<kaacore::NodeSpawnTransformation> transformations;
+            for (size_t i = 0; i < 1000; i++) {
+                transformations.push_back({{(i % 50) * 4., (i / 50) * 4.}});
+            }
+            // second batch is smaller than the index, so it's only
+            // inserted, the first one rebuilds BB tree
+            auto tmp_container = kaacore::make_node();
+            auto container = scene.root_node.add_child(tmp_container);
+            auto nodes =
+                container->spawn_children(node_template, transformations);
+            transformations.resize(300);
+            for (auto& transformation : transformations) {
+                transformation.position += glm::dvec2{1000., 0.};
+            }
+            auto more_nodes =
+                container->spawn_children(node_template, transformations);
+            nodes.insert(nodes.end(), more_nodes.begin(), more_nodes.end());
+
+            const kaacore::BoundingBox<double> bbox{-10., -10., 2000., 2000.};
+            REQUIRE(
+                scene.spatial_index.query_bounding_box(bbox).size() ==
+                nodes.size()
+            );
+            for (size_t i = 0; i < nodes.size(); i += 37) {
+                REQUIRE(
+                    to_nodes_set(
+                        scene.spatial_index.query_point(nodes[i]->position())
+                    ) == NodesSet{nodes[i].get()}
+                );
+            }
+        }
+    }
+}
+
+TEST_CASE("test_spatial_index_reusable_queries", "[spatial_index]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    std::vector<kaacore::NodePtr> nodes;
+    for (int i = 0; i < 100; i++) {
+        auto node = kaacore::make_node();
+        node->shape(kaacore::Shape::Box({8., 8.}));
+        node->position({(i % 10) * 10., (i / 10) * 10.});
+        node->indexable(true);
+        nodes.push_back(scene.root_node.add_child(node));
+    }
+    auto shapeless_node = kaacore::make_node();
+    shapeless_node->position({5., 5.});
+    shapeless_node->indexable(true);
+    scene.root_node.add_child(shapeless_node);
+
+    const kaacore::BoundingBox<double> bbox{-1., -1., 41., 21.};
+    const auto expected =
+        to_nodes_set(scene.spatial_index.query_bounding_box(bbox));
+    REQUIRE(expected.size() == 5 * 3 + 1);
+
+    SECTION("Buffer")
+    {
+        std::vector<kaacore::NodePtr> results;
+        scene.spatial_index.query_bounding_box(bbox, results);
+        REQUIRE(to_nodes_set(results) == expected);
+        const auto capacity = results.capacity();
+        const auto data = results.data();
+
+        scene.spatial_index.query_bounding_box(bbox, results, false);
+        REQUIRE(results.size() == expected.size() - 1);
+        REQUIRE(results.capacity() == capacity);
+        REQUIRE(results.data() == data);
+
+        scene.spatial_index.query_point({20., 20.}, results);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0] == nodes[22].get());
+        REQUIRE(results.data() == data);
+    }
+
+    SECTION("Callback")
+    {
+        NodesSet visited;
+        scene.spatial_index.query_bounding_box(
+            bbox,
+            [&visited](kaacore::NodePtr node) {
+                visited.insert(node.get());
+                return true;
+            }
+        );
+        REQUIRE(visited == expected);
+
+        size_t visits = 0;
+        scene.spatial_index.query_bounding_box(
+            bbox,
+            [&visits](kaacore::NodePtr) {
+                visits++;
+                return visits < 3;
+            }
+        );
+        REQUIRE(visits == 3);
+
+        visits = 0;
+        scene.spatial_index.query_point(
+            {20., 20.},
+            [&visits](kaacore::NodePtr) {
+                visits++;
+                return true;
+            }
+        );
+        REQUIRE(visits == 1);
+
+        // callback is referenced, not copied
+        struct {
+            size_t visits = 0;
+            bool operator()(kaacore::NodePtr)
+            {
+                this->visits++;
+                return true;
+            }
+        } counter;
+        scene.spatial_index.query_bounding_box(bbox, counter);
+        REQUIRE(counter.visits == expected.size());
+    }
+}
+
+TEST_CASE(
+    "test_spatial_index_segment_and_nearest_queries", "[spatial_index]"
+)
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    std::mt19937 random_engine{7};
+    std::uniform_real_distribution<double> coord_dist{0., 500.};
+    std::uniform_real_distribution<double> size_dist{1., 40.};
+    std::vector<kaacore::NodePtr> nodes;
+    std::set<kaacore::Node*> shapeless_nodes;
+    for (int i = 0; i < 300; i++) {
+        auto node = kaacore::make_node();
+        if (i % 30 == 0) {
+            shapeless_nodes.insert(node.get());
+        } else {
+            node->shape(kaacore::Shape::Box(
+                {size_dist(random_engine), size_dist(random_engine)}
+            ));
+        }
+        node->position({coord_dist(random_engine), coord_dist(random_engine)});
+        node->indexable(true);
+        nodes.push_back(scene.root_node.add_child(node));
+    }
+
+    // boxes are not rotated, so their shapes match bounding boxes
+    const auto brute_segment_entry =
+        [](const kaacore::BoundingBox<double>& bbox, const glm::dvec2 start,
+           const glm::dvec2 end) -> std::optional<double> {
+        const glm::dvec2 direction = end - start;
+        const glm::dvec2 bbox_min = {bbox.min_x, bbox.min_y};
+        const glm::dvec2 bbox_max = {bbox.max_x, bbox.max_y};
+        double t_min = 0.;
+        double t_max = 1.;
+        for (int axis = 0; axis < 2; axis++) {
+            if (direction[axis] == 0.) {
+                if (start[axis] < bbox_min[axis] or
+                    start[axis] > bbox_max[axis]) {
+                    return std::nullopt;
+                }
+                continue;
+            }
+            double t_near = (bbox_min[axis] - start[axis]) / direction[axis];
+            double t_far = (bbox_max[axis] - start[axis]) / direction[axis];
+            if (t_near > t_far) {
+                std::swap(t_near, t_far);
+            }
+            t_min = std::max(t_min, t_near);
+            t_max = std::min(t_max, t_far);
+            if (t_min > t_max) {
+                return std::nullopt;
+            }
+        }
+        return t_min * glm::length(direction);
+    };
+
+    const auto brute_distance = [](kaacore::NodePtr node,
+                                   const glm::dvec2 point) {
+        const auto bbox = node->bounding_box();
+        const glm::dvec2 outside = glm::max(
+            glm::dvec2{0., 0.},
+            glm::max(
+                glm::dvec2{bbox.min_x, bbox.min_y} - point,
+                point - glm::dvec2{bbox.max_x, bbox.max_y}
+            )
+        );
+        return glm::length(outside);
+    };
+
+    // nodes at equal distances may be ordered differently,
+    // so node of each result is checked against its own distance
+    using DistancesVector = std::vector<std::pair<double, kaacore::Node*>>;
+    const auto check_results =
+        [](const std::vector<kaacore::SpatialQueryResult>& results,
+           const DistancesVector& all_distances, const size_t count) {
+            std::map<kaacore::Node*, double> nodes_distances;
+            for (const auto& [distance, node] : all_distances) {
+                nodes_distances[node] = distance;
+            }
+            auto expected = all_distances;
+            std::sort(expected.begin(), expected.end());
+            expected.resize(std::min(expected.size(), count));
+            REQUIRE(results.size() == expected.size());
+            for (size_t i = 0; i < results.size(); i++) {
+                REQUIRE(
+                    results[i].distance ==
+                    Approx(expected[i].first).margin(1e-9)
+                );
+                REQUIRE(nodes_distances.count(results[i].node.get()) == 1);
+                REQUIRE(
+                    results[i].distance ==
+                    Approx(nodes_distances[results[i].node.get()]).margin(1e-9)
+                );
+            }
+        };
+
+    for (const auto& [name, use_backend] : spatial_index_backends) {
+        use_backend(scene.spatial_index);
+        for (int i = 0; i < 30; i++) {
+            const glm::dvec2 start = {
+                coord_dist(random_engine), coord_dist(random_engine)
+            };
+            const glm::dvec2 end = {
+                coord_dist(random_engine), coord_dist(random_engine)
+            };
+            DistancesVector expected;
+            for (const auto& node : nodes) {
+                if (shapeless_nodes.count(node.get())) {
+                    continue;
+                }
+                const auto entry =
+                    brute_segment_entry(node->bounding_box(), start, end);
+                if (entry) {
+                    expected.emplace_back(*entry, node.get());
+                }
+            }
+            const auto results = scene.spatial_index.query_segment(start, end);
+            check_results(results, expected, expected.size());
+            for (const auto& result : results) {
+                REQUIRE(
+                    glm::distance(start, result.point) ==
+                    Approx(result.distance).margin(1e-9)
+                );
+            }
+
+            const auto ray_results = scene.spatial_index.query_ray(
+                start, (end - start) * 3., glm::distance(start, end)
+            );
+            REQUIRE(ray_results.size() == results.size());
+            for (size_t j = 0; j < results.size(); j++) {
+                REQUIRE(
+                    ray_results[j].distance ==
+                    Approx(results[j].distance).margin(1e-9)
+                );
+            }
+        }
+
+        for (int i = 0; i < 30; i++) {
+            const glm::dvec2 point = {
+                coord_dist(random_engine), coord_dist(random_engine)
+            };
+            DistancesVector all_distances;
+            DistancesVector shaped_distances;
+            DistancesVector within_distance;
+            const double max_distance = 20.;
+            for (const auto& node : nodes) {
+                const double distance = brute_distance(node, point);
+                all_distances.emplace_back(distance, node.get());
+                if (not shapeless_nodes.count(node.get())) {
+                    shaped_distances.emplace_back(distance, node.get());
+                }
+                if (distance <= max_distance) {
+                    within_distance.emplace_back(distance, node.get());
+                }
+            }
+
+            check_results(
+                scene.spatial_index.query_nearest(point, 5), all_distances, 5
+            );
+            check_results(
+                scene.spatial_index.query_nearest(point, 5, 1e9, false),
+                shaped_distances, 5
+            );
+            check_results(
+                scene.spatial_index.query_nearest(point, 50, max_distance),
+                within_distance, 50
+            );
+        }
+    }
+
+    REQUIRE(scene.spatial_index.query_nearest({0., 0.}, 0).empty());
+    REQUIRE(
+        scene.spatial_index.query_nearest({0., 0.}, 1000).size() ==
+        nodes.size()
+    );
+}
+
+TEST_CASE(
+    "benchmark_spatial_index_backends", "[.][benchmark][spatial_index]"
+)
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    std::vector<kaacore::NodePtr> nodes;
+    for (int i = 0; i < 10000; i++) {
+        auto node = kaacore::make_node();
+        node->shape(kaacore::Shape::Box({8., 8.}));
+        node->position({(i % 100) * 10., (i / 100) * 10.});
+        node->indexable(true);
+        nodes.push_back(scene.root_node.add_child(node));
+    }
+    scene.resolve_spatial_index_changes(scene.build_processing_queue());
+
+    for (const auto& [name, use_backend] : spatial_index_backends) {
+        BENCHMARK(name + ", 10k nodes insert")
+        {
+            use_backend(scene.spatial_index);
+        };
+
+        use_backend(scene.spatial_index);
+        double offset = 0.;
+        BENCHMARK(name + ", 10k nodes update")
+        {
+            offset = offset > 0. ? 0. : 3.;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                nodes[i]->position(
+                    {(i % 100) * 10. + offset, (i / 100) * 10. + offset}
+                );
+            }
+            scene.resolve_spatial_index_changes(scene.build_processing_queue());
+        };
+
+        BENCHMARK(name + ", 1k queries")
+        {
+            size_t found = 0;
+            for (int i = 0; i < 1000; i++) {
+                const double x = (i * 37) % 1000;
+                const double y = (i * 91) % 1000;
+                found += scene.spatial_index
+                             .query_bounding_box({x, y, x + 30., y + 30.})
+                             .size();
+            }
+            return found;
+        };
+    }
+}
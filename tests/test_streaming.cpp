@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/engine.h"
+#include "kaacore/nodes.h"
+#include "kaacore/scenes.h"
+#include "kaacore/streaming.h"
+
+#include "runner.h"
+
+using namespace std::chrono_literals;
+
+using CellsSet = std::set<std::pair<int, int>>;
+
+CellsSet
+to_cells_set(const std::vector<glm::ivec2>& cells)
+{
+    CellsSet result;
+    for (const auto& cell : cells) {
+        result.emplace(cell.x, cell.y);
+    }
+    return result;
+}
+
+TEST_CASE("test_streaming_camera_flight", "[streaming]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+    auto& streaming = scene.streaming;
+
+    CellsSet loaded;
+    CellsSet unloaded;
+    streaming.cell_size({100., 100.});
+    streaming.distances(150., 250.);
+    streaming.frame_budget(1s);
+    streaming.loader([&](const glm::ivec2 cell) {
+        loaded.emplace(cell.x, cell.y);
+        auto node = kaacore::make_node();
+        node->position(
+            (glm::dvec2(cell) + glm::dvec2{0.5, 0.5}) * glm::dvec2{100., 100.}
+        );
+        return node;
+    });
+    streaming.unloader([&](const glm::ivec2 cell, kaacore::NodePtr root) {
+        REQUIRE(root);
+        unloaded.emplace(cell.x, cell.y);
+    });
+
+    // brute-force distance check over a synthetic grid
+    const auto cell_distance = [&](const glm::ivec2 cell) {
+        const auto bounds = streaming.cell_bounds(cell);
+        const glm::dvec2 position = scene.camera().position();
+        const glm::dvec2 closest = glm::clamp(
+            position, glm::dvec2{bounds.min_x, bounds.min_y},
+            glm::dvec2{bounds.max_x, bounds.max_y}
+        );
+        return glm::distance(position, closest);
+    };
+
+    CellsSet previous_active;
+    for (int step = 0; step <= 100; step++) {
+        scene.camera().position({step * 20., step * 5.});
+        streaming.process();
+        REQUIRE(streaming.pending_operations_count() == 0);
+
+        const auto active = to_cells_set(streaming.active_cells());
+        for (int y = -10; y <= 20; y++) {
+            for (int x = -10; x <= 40; x++) {
+                const double distance = cell_distance({x, y});
+                const bool is_active = active.count({x, y}) > 0;
+                if (distance <= 150.) {
+                    REQUIRE(is_active);
+                } else if (distance > 250.) {
+                    REQUIRE_FALSE(is_active);
+                } else {
+                    // hysteresis, cells between distances keep their state
+                    REQUIRE(is_active == (previous_active.count({x, y}) > 0));
+                }
+                if (is_active) {
+                    auto root = streaming.cell_root({x, y});
+                    REQUIRE(root);
+                    REQUIRE(root->parent() == &scene.root_node);
+                }
+            }
+        }
+        previous_active = active;
+    }
+
+    REQUIRE(loaded.count({0, 0}) == 1);
+    REQUIRE(unloaded.count({0, 0}) == 1);
+    REQUIRE(
+        streaming.cell_state({0, 0}) == kaacore::StreamingCellState::inactive
+    );
+    REQUIRE(
+        streaming.cell_state({20, 5}) == kaacore::StreamingCellState::active
+    );
+
+    // moving back and forth across cells borders does not churn cells
+    for (int step = 0; step < 2; step++) {
+        scene.camera().position({2000. + step * 60., 500.});
+        streaming.process();
+    }
+    loaded.clear();
+    unloaded.clear();
+    for (int step = 0; step < 10; step++) {
+        scene.camera().position({2000. + (step % 2) * 60., 500.});
+        streaming.process();
+    }
+    REQUIRE(loaded.empty());
+    REQUIRE(unloaded.empty());
+
+    streaming.clear();
+    REQUIRE(streaming.active_cells().empty());
+}
+
+TEST_CASE("test_streaming_frame_budget", "[streaming]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+    auto& streaming = scene.streaming;
+
+    const auto load_duration = 2ms;
+    size_t loads_count = 0;
+    streaming.cell_size({100., 100.});
+    streaming.distances(250., 350.);
+    streaming.frame_budget(5ms);
+    streaming.loader([&](const glm::ivec2) {
+        std::this_thread::sleep_for(load_duration);
+        loads_count++;
+        return kaacore::make_node();
+    });
+
+    scene.camera().position({0., 0.});
+    size_t frames = 0;
+    do {
+        const auto loads_before = loads_count;
+        streaming.process();
+        const auto frame_loads = loads_count - loads_before;
+        // each load takes at least 2ms, so budget allows at most
+        // 3 loads (the last one started before budget ran out)
+        REQUIRE(frame_loads >= 1);
+        REQUIRE(frame_loads <= 3);
+        frames++;
+    } while (streaming.pending_operations_count() > 0);
+
+    // 6x6 cells block around the camera, without corners
+    REQUIRE(loads_count == 32);
+    REQUIRE(frames >= 32 / 3);
+    REQUIRE(streaming.active_cells().size() == 32);
+
+    // closest cells are loaded first
+    std::vector<double> loads_distances;
+    streaming.loader([&](const glm::ivec2 cell) {
+        const auto bounds = streaming.cell_bounds(cell);
+        const glm::dvec2 position = scene.camera().position();
+        const glm::dvec2 closest = glm::clamp(
+            position, glm::dvec2{bounds.min_x, bounds.min_y},
+            glm::dvec2{bounds.max_x, bounds.max_y}
+        );
+        loads_distances.push_back(glm::distance(position, closest));
+        std::this_thread::sleep_for(load_duration);
+        return kaacore::make_node();
+    });
+    scene.camera().position({5000., 5000.});
+    do {
+        streaming.process();
+    } while (streaming.pending_operations_count() > 0);
+    REQUIRE(loads_distances.size() == 32);
+    REQUIRE(std::is_sorted(loads_distances.begin(), loads_distances.end()));
+    REQUIRE(
+        streaming.cell_state({0, 0}) == kaacore::StreamingCellState::inactive
+    );
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/nodes.h"
+#include "kaacore/scenes.h"
+
+#include "runner.h"
+
+TEST_CASE("test_tilemap_tiles", "[tilemap][no_engine]")
+{
+    auto node = kaacore::make_node(kaacore::NodeType::tilemap);
+    auto& tilemap = node->tilemap;
+    tilemap.tile_size({10., 10.});
+    tilemap.chunk_size(16);
+    REQUIRE(tilemap.tile({0, 0}) == kaacore::empty_tile);
+
+    SECTION("Setting and querying tiles")
+    {
+        tilemap.tile({0, 0}, 1);
+        tilemap.tile({15, 15}, 2);
+        tilemap.tile({16, 0}, 3);
+        tilemap.tile({-1, -1}, 4);
+        REQUIRE(tilemap.chunks_count() == 3);
+        REQUIRE(tilemap.dirty_chunks_count() == 3);
+        REQUIRE(node->children().size() == 3);
+
+        REQUIRE(tilemap.tile({0, 0}) == 1);
+        REQUIRE(tilemap.tile({15, 15}) == 2);
+        REQUIRE(tilemap.tile({16, 0}) == 3);
+        REQUIRE(tilemap.tile({-1, -1}) == 4);
+        REQUIRE(tilemap.tile({1, 0}) == kaacore::empty_tile);
+
+        REQUIRE(tilemap.chunk_position({-1, -1}) == glm::ivec2{-1, -1});
+        REQUIRE(tilemap.chunk_position({-16, 16}) == glm::ivec2{-1, 1});
+        REQUIRE(tilemap.chunk_position({-17, 15}) == glm::ivec2{-2, 0});
+
+        REQUIRE(tilemap.tile_position_at({5., 5.}) == glm::ivec2{0, 0});
+        REQUIRE(tilemap.tile_position_at({-0.5, 5.}) == glm::ivec2{-1, 0});
+        REQUIRE(tilemap.tile_at({159.9, 159.9}) == 2);
+        REQUIRE(tilemap.tile_at({165., 1.}) == 3);
+        REQUIRE(tilemap.tile_at({-5., -5.}) == 4);
+    }
+
+    SECTION("Rebuilding modified chunks only")
+    {
+        tilemap.fill({0, 0}, {19, 9}, 0);
+        REQUIRE(tilemap.chunks_count() == 2);
+        tilemap.rebuild_dirty_chunks();
+        REQUIRE(tilemap.dirty_chunks_count() == 0);
+
+        auto first_chunk = tilemap.chunk_node({0, 0});
+        auto second_chunk = tilemap.chunk_node({1, 0});
+        REQUIRE(first_chunk->shape().vertices.size() == 16 * 10 * 4);
+        REQUIRE(first_chunk->shape().indices.size() == 16 * 10 * 6);
+        REQUIRE(second_chunk->shape().vertices.size() == 4 * 10 * 4);
+        REQUIRE(second_chunk->position() == glm::dvec2{160., 0.});
+
+        // setting the same tile again doesn't modify the chunk
+        tilemap.tile({17, 0}, 0);
+        REQUIRE(tilemap.dirty_chunks_count() == 0);
+
+        tilemap.tile({17, 0}, 5);
+        REQUIRE(tilemap.dirty_chunks_count() == 1);
+        tilemap.rebuild_dirty_chunks();
+        REQUIRE(second_chunk->shape().vertices.size() == 4 * 10 * 4);
+
+        // chunks left without tiles are dropped
+        tilemap.fill({16, 0}, {31, 15}, kaacore::empty_tile);
+        tilemap.rebuild_dirty_chunks();
+        REQUIRE(tilemap.chunks_count() == 1);
+        REQUIRE(tilemap.chunk_node({1, 0}) == nullptr);
+        REQUIRE(node->children().size() == 1);
+
+        REQUIRE_THROWS(tilemap.chunk_size(32));
+        tilemap.clear();
+        REQUIRE(tilemap.chunks_count() == 0);
+        REQUIRE(node->children().empty());
+        REQUIRE_NOTHROW(tilemap.chunk_size(32));
+    }
+
+    SECTION("Large map")
+    {
+        tilemap.chunk_size(64);
+        tilemap.fill({0, 0}, {1023, 1023}, 0);
+        REQUIRE(tilemap.chunks_count() == 256);
+        tilemap.rebuild_dirty_chunks();
+        REQUIRE(node->children().size() == 256);
+        REQUIRE(tilemap.tile_at({10235., 10235.}) == 0);
+        REQUIRE(tilemap.tile_at({10245., 10235.}) == kaacore::empty_tile);
+    }
+}
+
+TEST_CASE("test_tilemap_in_scene", "[tilemap]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_node = kaacore::make_node(kaacore::NodeType::tilemap);
+    auto node = scene.root_node.add_child(tmp_node);
+    node->tilemap.chunk_size(8);
+    node->tilemap.fill({0, 0}, {15, 3}, 0);
+    REQUIRE(node->tilemap.chunks_count() == 2);
+
+    scene.update_nodes_drawing_queue(scene.build_processing_queue());
+    REQUIRE(node->tilemap.dirty_chunks_count() == 0);
+    auto chunk = node->tilemap.chunk_node({0, 0});
+    REQUIRE(chunk->shape().vertices.size() == 8 * 4 * 4);
+    REQUIRE_FALSE(chunk->query_dirty_flags(kaacore::Node::DIRTY_DRAW_VERTICES));
+
+    node->tilemap.fill({0, 0}, {7, 7}, kaacore::empty_tile);
+    scene.update_nodes_drawing_queue(scene.build_processing_queue());
+    REQUIRE(node->tilemap.chunks_count() == 1);
+    scene.remove_marked_nodes();
+    REQUIRE(node->children().size() == 1);
+
+    // all children are chunks, they are dropped in bulk
+    node->tilemap.fill({0, 0}, {63, 63}, 0);
+    REQUIRE(node->children().size() == 64);
+    node->tilemap.clear();
+    REQUIRE(node->tilemap.chunks_count() == 0);
+    REQUIRE(node->tilemap.dirty_chunks_count() == 0);
+    scene.remove_marked_nodes();
+    REQUIRE(node->children().empty());
+}
+
+TEST_CASE("test_tilemap_chunks_removal", "[tilemap]")
+{
+    kaacore::initialize_logging();
+    auto engine = initialize_testing_engine();
+    TestingScene scene;
+
+    auto tmp_node = kaacore::make_node(kaacore::NodeType::tilemap);
+    tmp_node->tilemap.chunk_size(4);
+    auto tmp_other_child = kaacore::make_node();
+    auto other_child = tmp_node->add_child(tmp_other_child);
+    tmp_node->tilemap.fill({0, 0}, {15, 3}, 0);
+    REQUIRE(tmp_node->children().size() == 5);
+
+    const auto require_chunks = [&](kaacore::Node* tilemap_node) {
+        auto& tilemap = tilemap_node->tilemap;
+        auto children = tilemap_node->children();
+        REQUIRE(children.size() == tilemap.chunks_count() + 1);
+        REQUIRE(
+            std::count(children.begin(), children.end(), other_child.get()) ==
+            1
+        );
+        for (int x = 0; x < 4; x++) {
+            auto chunk = tilemap.chunk_node({x, 0});
+            if (chunk) {
+                REQUIRE(chunk->parent() == tilemap_node);
+                REQUIRE(
+                    std::count(children.begin(), children.end(), chunk) == 1
+                );
+            }
+        }
+    };
+
+    SECTION("Without scene")
+    {
+        // emptied chunk in the middle of children is swapped out
+        tmp_node->tilemap.fill({4, 0}, {7, 3}, kaacore::empty_tile);
+        tmp_node->tilemap.rebuild_dirty_chunks();
+        REQUIRE(tmp_node->tilemap.chunks_count() == 3);
+        require_chunks(tmp_node.get());
+
+        tmp_node->prepare_subtree();
+        tmp_node->tilemap.clear();
+        REQUIRE(tmp_node->tilemap.chunks_count() == 0);
+        require_chunks(tmp_node.get());
+    }
+
+    SECTION("In scene")
+    {
+        auto node = scene.root_node.add_child(tmp_node);
+        node->tilemap.fill({4, 0}, {7, 3}, kaacore::empty_tile);
+        scene.update_nodes_drawing_queue(scene.build_processing_queue());
+        scene.remove_marked_nodes();
+        REQUIRE(node->tilemap.chunks_count() == 3);
+        require_chunks(node.get());
+
+        node->tilemap.clear();
+        scene.remove_marked_nodes();
+        REQUIRE(node->tilemap.chunks_count() == 0);
+        require_chunks(node.get());
+        REQUIRE_FALSE(other_child.is_marked_to_delete());
+    }
+}
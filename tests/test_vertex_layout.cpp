@@ -0,0 +1,145 @@
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <glm/glm.hpp>
+
+#include "kaacore/shapes.h"
+#include "kaacore/vertex_layout.h"
+
+namespace {
+
+std::vector<kaacore::StandardVertexData>
+make_glyph_quads(const size_t glyphs_count)
+{
+    std::vector<kaacore::StandardVertexData> vertices;
+    for (size_t i = 0; i < glyphs_count; i++) {
+        const float x = i * 10.f;
+        vertices.push_back(
+            kaacore::StandardVertexData::xy_uv_mn(x, 0., 0., 0., 0., 0.)
+        );
+        vertices.push_back(
+            kaacore::StandardVertexData::xy_uv_mn(x + 8., 0., 1., 0., 1., 0.)
+        );
+        vertices.push_back(
+            kaacore::StandardVertexData::xy_uv_mn(x + 8., 12., 1., 1., 1., 1.)
+        );
+        vertices.push_back(
+            kaacore::StandardVertexData::xy_uv_mn(x, 12., 0., 1., 0., 1.)
+        );
+    }
+    return vertices;
+}
+
+kaacore::VertexTransformParams
+make_transform_params()
+{
+    kaacore::VertexTransformParams params;
+    params.x_axis = {1.5, 0.75};
+    params.y_axis = {-0.75, 1.5};
+    params.translation = {100., -25.};
+    params.uv_origin = {0.25, 0.5};
+    params.uv_span = {0.5, 0.25};
+    params.color = {0.1, 0.2, 0.3, 0.4};
+    return params;
+}
+
+} // namespace
+
+TEST_CASE(
+    "test_vertex_transform", "[vertex_layout][vertex_transform][no_engine]"
+)
+{
+    const auto params = make_transform_params();
+    const std::vector<std::vector<kaacore::StandardVertexData>> sources = {
+        kaacore::Shape::Box({10., 20.}).vertices,
+        kaacore::Shape::Circle(10.).vertices,
+        make_glyph_quads(1),
+        make_glyph_quads(33),
+    };
+
+    for (const auto& source : sources) {
+        // extra vertex at the end checks for out of bounds writes
+        std::vector<kaacore::StandardVertexData> result(source.size() + 1);
+        result.back().xyz.x = 12345.;
+        kaacore::transform_vertices(
+            source.data(), result.data(), source.size(), params
+        );
+
+        for (size_t i = 0; i < source.size(); i++) {
+            const auto& src = source[i];
+            const auto& dst = result[i];
+            REQUIRE(
+                dst.xyz.x == Approx(
+                                 src.xyz.x * params.x_axis.x +
+                                 src.xyz.y * params.y_axis.x +
+                                 params.translation.x
+                             )
+            );
+            REQUIRE(
+                dst.xyz.y == Approx(
+                                 src.xyz.x * params.x_axis.y +
+                                 src.xyz.y * params.y_axis.y +
+                                 params.translation.y
+                             )
+            );
+            REQUIRE(dst.xyz.z == src.xyz.z);
+            REQUIRE(
+                dst.uv.x ==
+                Approx(params.uv_origin.x + src.uv.x * params.uv_span.x)
+            );
+            REQUIRE(
+                dst.uv.y ==
+                Approx(params.uv_origin.y + src.uv.y * params.uv_span.y)
+            );
+            REQUIRE(dst.mn == src.mn);
+            REQUIRE(dst.rgba == params.color);
+        }
+        REQUIRE(result.back().xyz.x == 12345.f);
+    }
+}
+
+TEST_CASE(
+    "benchmark_vertex_transform",
+    "[.][benchmark][vertex_layout][vertex_transform][no_engine]"
+)
+{
+    const auto params = make_transform_params();
+    const auto box_vertices = kaacore::Shape::Box({10., 20.}).vertices;
+    const auto circle_vertices =
+        kaacore::Shape::Polygon(kaacore::Shape::Circle(10.).bounding_points)
+            .vertices;
+    const auto text_vertices = make_glyph_quads(64);
+    const auto large_vertices = make_glyph_quads(25000);
+
+    auto run_transform = [&params](
+                             const std::vector<kaacore::StandardVertexData>&
+                                 source,
+                             const size_t repeats
+                         ) {
+        std::vector<kaacore::StandardVertexData> result(source.size());
+        for (size_t i = 0; i < repeats; i++) {
+            kaacore::transform_vertices(
+                source.data(), result.data(), source.size(), params
+            );
+        }
+        return result.back().xyz.x;
+    };
+
+    // emulates per-node calls, which operate on small arrays
+    BENCHMARK("box x1000")
+    {
+        return run_transform(box_vertices, 1000);
+    };
+    BENCHMARK("24-point circle x1000")
+    {
+        return run_transform(circle_vertices, 1000);
+    };
+    BENCHMARK("64 glyphs text x1000")
+    {
+        return run_transform(text_vertices, 1000);
+    };
+    BENCHMARK("100k vertices")
+    {
+        return run_transform(large_vertices, 1);
+    };
+}